@@ -3,47 +3,116 @@
 #include <string.h>
 #include <stdio.h>
 
-AST *ast_new(NodeKind kind, const char *name, int lineno) {
-    AST *n = (AST*)malloc(sizeof(AST));
+/* the chunk header occupies slot 0 */
+typedef char ast_chunk_header_fits[sizeof(AstChunkHeader) <= sizeof(AST) ? 1 : -1];
+
+/* chunks must be aligned to their size for ast_arena_of */
+static AST *chunk_alloc(void) {
+#ifdef _WIN32
+    return (AST*)_aligned_malloc(AST_CHUNK_SIZE, AST_CHUNK_SIZE);
+#else
+    void *p = NULL;
+    return posix_memalign(&p, AST_CHUNK_SIZE, AST_CHUNK_SIZE) == 0 ? (AST*)p : NULL;
+#endif
+}
+
+static void chunk_free(AST *chunk) {
+#ifdef _WIN32
+    _aligned_free(chunk);
+#else
+    free(chunk);
+#endif
+}
+
+AstArena *ast_arena_create(InternPool *names) {
+    AstArena *arena = (AstArena*)calloc(1, sizeof(AstArena));
+    if (!arena) return NULL;
+    arena->names = names;
+    arena->nextSlot = AST_CHUNK_NODES;   /* no chunk yet */
+    return arena;
+}
+
+void ast_arena_destroy(AstArena *arena) {
+    if (!arena) return;
+    for (AstIndex i = 0; i < arena->chunkCount; i++) chunk_free(arena->chunks[i]);
+    free(arena->chunks);
+    free(arena);
+}
+
+static AST *node_alloc(AstArena *arena) {
+    if (arena->nextSlot == AST_CHUNK_NODES) {
+        if (arena->chunkCount == arena->chunkCapacity) {
+            AstIndex capacity = arena->chunkCapacity ? arena->chunkCapacity * 2 : 16;
+            AST **chunks = (AST**)realloc(arena->chunks, capacity * sizeof(AST*));
+            if (!chunks) return NULL;
+            arena->chunks = chunks;
+            arena->chunkCapacity = capacity;
+        }
+        AST *chunk = chunk_alloc();
+        if (!chunk) return NULL;
+        AstChunkHeader *header = (AstChunkHeader*)chunk;
+        header->arena = arena;
+        header->base = arena->chunkCount * AST_CHUNK_NODES;
+        arena->chunks[arena->chunkCount++] = chunk;
+        arena->nextSlot = 1;
+    }
+    return arena->chunks[arena->chunkCount - 1] + arena->nextSlot++;
+}
+
+AST *ast_new(AstArena *arena, NodeKind kind, InternId name, int lineno) {
+    AST *n = node_alloc(arena);
+    memset(n, 0, sizeof(AST));
     n->kind = kind;
-    n->name = name ? strdup(name) : NULL;
-    n->typeName = NULL;
-    n->intValue = 0;
-    n->floatValue = 0.0;
+    n->nameId = name;
     n->lineno = lineno;
-    n->child = n->sibling = n->extra = NULL;
     return n;
 }
 
-AST *ast_new_int(int val, int lineno) {
-    AST *n = ast_new(NODE_INT_LITERAL, NULL, lineno);
+/* indexed by OpCode */
+static const InternId op_spelling[OP_COUNT] = {
+    0,
+    INTERN_PLUS, INTERN_MINUS, INTERN_TIMES, INTERN_DIVIDE,
+    INTERN_AND, INTERN_OR,
+    INTERN_EQ, INTERN_NE, INTERN_LT, INTERN_GT, INTERN_LE, INTERN_GE,
+    INTERN_INDEX,
+    INTERN_NOT, INTERN_MINUS, INTERN_PLUS
+};
+
+AST *ast_new_op(AstArena *arena, NodeKind kind, OpCode op, int lineno) {
+    AST *n = ast_new(arena, kind, op_spelling[op], lineno);
+    n->op = op;
+    return n;
+}
+
+AST *ast_new_int(AstArena *arena, int val, int lineno) {
+    AST *n = ast_new(arena, NODE_INT_LITERAL, 0, lineno);
     n->intValue = val;
     return n;
 }
 
-AST *ast_new_float(double val, int lineno) {
-    AST *n = ast_new(NODE_FLOAT_LITERAL, NULL, lineno);
+AST *ast_new_float(AstArena *arena, double val, int lineno) {
+    AST *n = ast_new(arena, NODE_FLOAT_LITERAL, 0, lineno);
     n->floatValue = val;
     return n;
 }
 
-AST *ast_new_string(const char *val, int lineno) {
-    AST *n = ast_new(NODE_STRING_LITERAL, strdup(val), lineno);
-    return n;
+AST *ast_new_string(AstArena *arena, InternId val, int lineno) {
+    return ast_new(arena, NODE_STRING_LITERAL, val, lineno);
 }
 
 void ast_append_child(AST *parent, AST *child) {
     if (!parent) return;
-    if (!parent->child) parent->child = child;
-    else ast_append_sibling(&parent->child, child);
+    AST *first = ast_child(parent);
+    if (!first) ast_set_child(parent, child);
+    else ast_append_sibling(&first, child);
 }
 
 void ast_append_sibling(AST **list, AST *node) {
     if (!list || !node) return;
     if (!*list) { *list = node; return; }
     AST *p = *list;
-    while (p->sibling) p = p->sibling;
-    p->sibling = node;
+    while (p->siblingIndex) p = ast_sibling(p);
+    ast_set_sibling(p, node);
 }
 
 static void print_indent(int indent) {
@@ -59,28 +128,32 @@ void ast_print(AST *node, int indent) {
             break;
         case NODE_CLASS_DECL:
             printf("CLASS_DECL name=%s (line %d)\n",
-            node->name?node->name:"", node->lineno);
+            ast_name(node)?ast_name(node):"", node->lineno);
             break;
         case NODE_ATTRIBUTE:
             printf("ATTRIBUTE name=%s type=%s (line %d)\n",
-            node->name?node->name:"", node->typeName?node->typeName:"", node->lineno);
+            ast_name(node)?ast_name(node):"", ast_type_name(node)?ast_type_name(node):"", node->lineno);
             break;
         case NODE_FUNC_DECL:
             printf("FUNC_DECL name=%s return=%s (line %d)\n",
-            node->name?node->name:"", node->typeName?node->typeName:"", node->lineno);
+            ast_name(node)?ast_name(node):"", ast_type_name(node)?ast_type_name(node):"", node->lineno);
             break;
         case NODE_VAR_DECL:
             printf("VAR_DECL name=%s type=%s (line %d)\n",
-            node->name?node->name:"", node->typeName?node->typeName:"", node->lineno);
+            ast_name(node)?ast_name(node):"", ast_type_name(node)?ast_type_name(node):"", node->lineno);
             break;
         case NODE_PARAM:
             printf("PARAM name=%s type=%s (line %d)\n",
-            node->name?node->name:"", node->typeName?node->typeName:"", node->lineno);
+            ast_name(node)?ast_name(node):"", ast_type_name(node)?ast_type_name(node):"", node->lineno);
             break;
         case NODE_ASSIGN:
             printf("ASSIGN (line %d)\n",
             node->lineno);
             break;
+        case NODE_STATEMENT_LIST:
+            printf("BLOCK (line %d)\n",
+            node->lineno);
+            break;
         case NODE_IF:
             printf("IF (line %d)\n",
             node->lineno);
@@ -103,11 +176,11 @@ void ast_print(AST *node, int indent) {
             break;
         case NODE_FUNCTION_CALL:
             printf("CALL name=%s (line %d)\n",
-            node->name?node->name:"", node->lineno);
+            ast_name(node)?ast_name(node):"", node->lineno);
             break;
         case NODE_ID:
             printf("ID name=%s (line %d)\n",
-            node->name?node->name:"", node->lineno);
+            ast_name(node)?ast_name(node):"", node->lineno);
             break;
         case NODE_INT_LITERAL:
             printf("INT %d (line %d)\n",
@@ -119,15 +192,15 @@ void ast_print(AST *node, int indent) {
             break;
         case NODE_STRING_LITERAL:
             printf("STRING \"%s\" (line %d)\n",
-            node->name?node->name:"", node->lineno);
+            ast_name(node)?ast_name(node):"", node->lineno);
             break;
         case NODE_BINARY_OP:
             printf("BINOP %s (line %d)\n",
-            node->name?node->name:"", node->lineno);
+            ast_name(node)?ast_name(node):"", node->lineno);
             break;
         case NODE_UNARY_OP:
             printf("UNOP %s (line %d)\n",
-            node->name?node->name:"", node->lineno);
+            ast_name(node)?ast_name(node):"", node->lineno);
             break;
         default:
             printf("NODE kind=%d (line %d)\n",
@@ -135,29 +208,15 @@ void ast_print(AST *node, int indent) {
             break;
     }
     // print children
-    AST *c = node->child;
+    AST *c = ast_child(node);
     while (c) {
         ast_print(c, indent+1);
-        c = c->sibling;
+        c = ast_sibling(c);
     }
     // extra pointer (for some structures)
-    if (node->extra) {
+    if (ast_extra(node)) {
         print_indent(indent+1);
         printf("EXTRA:\n");
-        ast_print(node->extra, indent+2);
-    }
-}
-
-void ast_free(AST *node) {
-    if (!node) return;
-    AST *c = node->child;
-    while (c) {
-        AST *next = c->sibling;
-        ast_free(c);
-        c = next;
+        ast_print(ast_extra(node), indent+2);
     }
-    if (node->extra) ast_free(node->extra);
-    if (node->name) free(node->name);
-    if (node->typeName) free(node->typeName);
-    free(node);
 }
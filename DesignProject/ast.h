@@ -2,6 +2,9 @@
 #define AST_H
 
 #include <stdio.h>
+#include <stdint.h>
+#include "intern.h"
+#include "types.h"
 
 typedef enum {
     NODE_PROGRAM,
@@ -33,25 +36,102 @@ typedef enum {
     NODE_EMPTY
 } NodeKind;
 
+/* operator of a BINARY_OP / UNARY_OP node, decoded by the parser; the
+   node's name keeps the spelling for printing */
+typedef enum {
+    OP_NONE,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV,
+    OP_AND, OP_OR,
+    OP_EQ, OP_NE, OP_LT, OP_GT, OP_LE, OP_GE,
+    OP_INDEX,
+    OP_NOT, OP_NEG, OP_POS,        /* unary */
+    OP_COUNT
+} OpCode;
+
+typedef unsigned int AstIndex;   /* node number in its arena; 0 is "no node" */
+
+/* 40 bytes: links are 32-bit node numbers, strings and types are ids and
+   the per-kind payloads share storage. Read the links and strings through
+   the accessors below. */
 typedef struct AST {
-    NodeKind kind;
-    char *name;               // identifier or operator
-    char *typeName;           // for type nodes or annotated type
-    int intValue;             // for integer literals
-    double floatValue;        // for float literals
+    union {
+        int intValue;             // for integer literals
+        double floatValue;        // for float literals
+        struct SymTable *scope;   // FUNC_DECL/CLASS_DECL: scope built by semantic pass A
+        struct {                  // BINARY_OP/UNARY_OP
+            OpCode op;
+            unsigned short regNeed;   // codegen: Sethi-Ullman label, 0 until computed
+            unsigned short hasCall;   // codegen: set with regNeed when the subtree calls a function
+        };
+        struct Symbol *symbol;    // ID/FUNCTION_CALL: declaration resolved by semantic pass B
+    };
+    InternId nameId;          // identifier or operator
+    InternId typeNameId;      // declared type name, as written
+    TypeId typeId;            // set by semantic analysis: declared type of a declaration, type of an expression
+    AstIndex childIndex;      // first child
+    AstIndex siblingIndex;    // next sibling (for lists)
+    AstIndex extraIndex;      // auxiliary (e.g., rhs for assign)
     int lineno;
-    struct AST *child;        // first child
-    struct AST *sibling;      // next sibling (for lists)
-    struct AST *extra;        // auxiliary (e.g., rhs for assign)
+    NodeKind kind;
 } AST;
 
-AST *ast_new(NodeKind kind, const char *name, int lineno);
-AST *ast_new_int(int val, int lineno);
-AST *ast_new_float(double val, int lineno);
-AST *ast_new_string(const char *val, int lineno);
+/* per-compilation node store. Nodes live in chunks of AST_CHUNK_SIZE bytes
+   aligned to that size; slot 0 of each chunk is its header, so a node finds
+   its arena from its own address. */
+#define AST_CHUNK_SIZE 65536
+#define AST_CHUNK_NODES ((AstIndex)(AST_CHUNK_SIZE / sizeof(AST)))
+
+typedef struct AstArena {
+    AST **chunks;
+    AstIndex chunkCount;
+    AstIndex chunkCapacity;
+    AstIndex nextSlot;            /* next free slot in the last chunk */
+    InternPool *names;            /* the compilation's pool; not owned */
+} AstArena;
+
+typedef struct AstChunkHeader {
+    AstArena *arena;
+    AstIndex base;                /* node number of slot 0 */
+} AstChunkHeader;
+
+/* names is borrowed and must outlive the arena */
+AstArena *ast_arena_create(InternPool *names);
+/* releases every node at once */
+void ast_arena_destroy(AstArena *arena);
+
+static inline AstArena *ast_arena_of(const AST *n) {
+    return ((const AstChunkHeader*)((uintptr_t)n & ~(uintptr_t)(AST_CHUNK_SIZE - 1)))->arena;
+}
+
+static inline AST *ast_node_at(const AstArena *arena, AstIndex index) {
+    return index ? arena->chunks[index / AST_CHUNK_NODES] + index % AST_CHUNK_NODES : NULL;
+}
+
+static inline AstIndex ast_index_of(const AST *n) {
+    if (!n) return 0;
+    const AST *chunk = (const AST*)((uintptr_t)n & ~(uintptr_t)(AST_CHUNK_SIZE - 1));
+    return ((const AstChunkHeader*)chunk)->base + (AstIndex)(n - chunk);
+}
+
+static inline AST *ast_child(const AST *n) { return ast_node_at(ast_arena_of(n), n->childIndex); }
+static inline AST *ast_sibling(const AST *n) { return ast_node_at(ast_arena_of(n), n->siblingIndex); }
+static inline AST *ast_extra(const AST *n) { return ast_node_at(ast_arena_of(n), n->extraIndex); }
+static inline void ast_set_child(AST *n, AST *c) { n->childIndex = ast_index_of(c); }
+static inline void ast_set_sibling(AST *n, AST *s) { n->siblingIndex = ast_index_of(s); }
+static inline void ast_set_extra(AST *n, AST *e) { n->extraIndex = ast_index_of(e); }
+
+static inline const char *ast_name(const AST *n) { return intern_str(ast_arena_of(n)->names, n->nameId); }
+static inline const char *ast_type_name(const AST *n) { return intern_str(ast_arena_of(n)->names, n->typeNameId); }
+static inline void ast_set_type_name(AST *n, InternId typeName) { n->typeNameId = typeName; }
+
+AST *ast_new(AstArena *arena, NodeKind kind, InternId name, int lineno);
+/* an operator node named by the operator's spelling */
+AST *ast_new_op(AstArena *arena, NodeKind kind, OpCode op, int lineno);
+AST *ast_new_int(AstArena *arena, int val, int lineno);
+AST *ast_new_float(AstArena *arena, double val, int lineno);
+AST *ast_new_string(AstArena *arena, InternId val, int lineno);
 void ast_append_child(AST *parent, AST *child);
 void ast_append_sibling(AST **list, AST *node);
 void ast_print(AST *node, int indent);
-void ast_free(AST *node);
 
 #endif
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "batch.h"
+#include "compiler.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+typedef struct BatchJob {
+    const char *source;
+    char *prefix;                  /* <outputDir>/<stem>. */
+    int result;
+} BatchJob;
+
+typedef struct BatchQueue {
+    const BatchOptions *batch;
+    BatchJob *jobs;
+    int count;
+    int next;                      /* next unclaimed job */
+#ifndef _WIN32
+    pthread_mutex_t lock;
+#endif
+} BatchQueue;
+
+static int make_output_dir(const char *dir) {
+#ifdef _WIN32
+    if (_mkdir(dir) == 0 || errno == EEXIST) return 0;
+#else
+    if (mkdir(dir, 0777) == 0 || errno == EEXIST) return 0;
+#endif
+    return -1;
+}
+
+/* file name without directory and last extension */
+static char *source_stem(const char *path) {
+    const char *base = path;
+    for (const char *p = path; *p; p++)
+        if (*p == '/' || *p == '\\') base = p + 1;
+    const char *dot = strrchr(base, '.');
+    size_t len = (dot && dot != base) ? (size_t)(dot - base) : strlen(base);
+    char *stem = (char*)malloc(len + 1);
+    if (!stem) return NULL;
+    memcpy(stem, base, len);
+    stem[len] = '\0';
+    return stem;
+}
+
+static int prefix_taken(const BatchJob *jobs, int count, const char *prefix) {
+    for (int i = 0; i < count; i++)
+        if (strcmp(jobs[i].prefix, prefix) == 0) return 1;
+    return 0;
+}
+
+/* output prefixes are fixed before any worker starts, so two sources with
+   the same stem never race for the same artifact names */
+static int assign_prefixes(const BatchOptions *batch, BatchJob *jobs) {
+    for (int i = 0; i < batch->sourceCount; i++) {
+        char *stem = source_stem(batch->sources[i]);
+        if (!stem) return -1;
+        size_t size = strlen(batch->outputDir) + strlen(stem) + 16;
+        char *prefix = (char*)malloc(size);
+        if (!prefix) { free(stem); return -1; }
+        snprintf(prefix, size, "%s/%s.", batch->outputDir, stem);
+        for (int n = 2; prefix_taken(jobs, i, prefix); n++)
+            snprintf(prefix, size, "%s/%s-%d.", batch->outputDir, stem, n);
+        free(stem);
+        jobs[i].source = batch->sources[i];
+        jobs[i].prefix = prefix;
+    }
+    return 0;
+}
+
+static const char *job_status(int result) {
+    switch (result) {
+        case 0:                       return "ok";
+        case COMPILE_SEMANTIC_ERRORS: return "failed (semantic errors)";
+        case COMPILE_CODEGEN_FAILED:  return "failed (code generation)";
+        default:                      return "failed";
+    }
+}
+
+static void run_job(const BatchOptions *batch, BatchJob *job) {
+    CompileOptions opts = batch->base;
+    opts.sourcePath = job->source;
+    opts.outputPrefix = job->prefix;
+    opts.quiet = 1;
+    job->result = compiler_compile(&opts);
+}
+
+#ifndef _WIN32
+static void *batch_worker(void *arg) {
+    BatchQueue *queue = (BatchQueue*)arg;
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        int index = queue->next < queue->count ? queue->next++ : -1;
+        pthread_mutex_unlock(&queue->lock);
+        if (index < 0) break;
+        run_job(queue->batch, &queue->jobs[index]);
+    }
+    return NULL;
+}
+#endif
+
+static int default_jobs(void) {
+#if defined(_WIN32) || !defined(_SC_NPROCESSORS_ONLN)
+    return 1;
+#else
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+#endif
+}
+
+static void run_queue(BatchQueue *queue, int jobs) {
+#ifndef _WIN32
+    if (jobs > 1) {
+        pthread_t *threads = (pthread_t*)malloc((size_t)jobs * sizeof(pthread_t));
+        int started = 0;
+        if (threads) {
+            pthread_mutex_init(&queue->lock, NULL);
+            while (started < jobs && pthread_create(&threads[started], NULL, batch_worker, queue) == 0)
+                started++;
+            /* with no thread at all the loop below does the work inline */
+            if (started == 0) pthread_mutex_destroy(&queue->lock);
+        }
+        if (started > 0) {
+            for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+            pthread_mutex_destroy(&queue->lock);
+            free(threads);
+            return;
+        }
+        free(threads);
+    }
+#else
+    (void)jobs;
+#endif
+    for (; queue->next < queue->count; queue->next++)
+        run_job(queue->batch, &queue->jobs[queue->next]);
+}
+
+int batch_compile(const BatchOptions *batch) {
+    if (make_output_dir(batch->outputDir) != 0) {
+        perror(batch->outputDir);
+        return 1;
+    }
+    BatchJob *jobs = (BatchJob*)calloc((size_t)batch->sourceCount, sizeof(BatchJob));
+    if (!jobs || assign_prefixes(batch, jobs) != 0) {
+        fprintf(stderr, "Out of memory.\n");
+        if (jobs)
+            for (int i = 0; i < batch->sourceCount; i++) free(jobs[i].prefix);
+        free(jobs);
+        return 1;
+    }
+
+    int workers = batch->jobs > 0 ? batch->jobs : default_jobs();
+    if (workers > batch->sourceCount) workers = batch->sourceCount;
+    BatchQueue queue;
+    memset(&queue, 0, sizeof(queue));
+    queue.batch = batch;
+    queue.jobs = jobs;
+    queue.count = batch->sourceCount;
+    run_queue(&queue, workers);
+
+    /* report in command-line order, whatever order the workers finished in */
+    int failed = 0;
+    for (int i = 0; i < batch->sourceCount; i++) {
+        printf("%s -> %s*: %s\n", jobs[i].source, jobs[i].prefix, job_status(jobs[i].result));
+        if (jobs[i].result != 0) failed++;
+        free(jobs[i].prefix);
+    }
+    printf("Compiled %d of %d file(s) into %s using %d worker(s).\n",
+           batch->sourceCount - failed, batch->sourceCount, batch->outputDir, workers);
+    free(jobs);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "compiler.h"
+
+/* compile many sources into one output directory on a pool of workers */
+typedef struct BatchOptions {
+    CompileOptions base;           /* artifact modes shared by every file */
+    const char *outputDir;
+    int jobs;                      /* worker count; <= 0 uses the online CPUs */
+    const char **sources;
+    int sourceCount;
+} BatchOptions;
+
+/* artifacts of dir/name.src go to <outputDir>/name.<artifact>; repeated
+   stems get a -2, -3, ... suffix. Returns 0 if every file compiled. */
+int batch_compile(const BatchOptions *batch);
+
+#endif
@@ -1,52 +1,51 @@
 #include "codegen.h"
 #include "symbol_table.h"
+#include "x86_code.h"
+#include "regalloc.h"
+#include "peephole.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 
-/* string literal mapping for .data section */
+/* a constant pool for the .data section: entries in first-use order, so an
+   entry's position is its label number, indexed by an open-addressing hash
+   table kept at most half full. Keys are a string literal's InternId or a
+   float literal's bit pattern */
 typedef struct {
-    char *str;
-    int index;
-} StringMapping;
+    unsigned long long key;
+    const AST *literal;           /* first literal with this key; NULL for the sign mask */
+} PoolEntry;
 
-static StringMapping string_map[100];
-static int string_map_count = 0;
-
-/* float literal mapping for .data section */
 typedef struct {
-    double value;
-    int index;
-} FloatMapping;
-
-static FloatMapping float_map[100];
-static int float_map_count = 0;
+    PoolEntry *entries;
+    int count;
+    int capacity;
+    int *slots;                   /* entry position + 1; 0 when empty */
+    int slotCapacity;
+} ConstPool;
 
 /* x86-32 Architecture Configuration */
-#define REG_POOL 6  /* EAX, EBX, ECX, EDX, ESI, EDI (EBP and ESP are special) */
 #define WORD_SIZE 4  /* x86-32 uses 32-bit (4 bytes) words */
 
-/* x86 General Purpose Registers (excluding EBP, ESP which are special) */
-static const char *REG_NAMES[REG_POOL] = {"EAX", "EBX", "ECX", "EDX", "ESI", "EDI"};
-
-/* IR temporary counter for 3AC */
-static int ir_temp_counter = 0;
-
 typedef struct {
     FILE *out;
-    int available[REG_POOL];
     int labelCounter;
     int tempCounter;  /* for 3AC temporaries */
+    int failed;       /* out of memory while building an instruction list */
+    ConstPool strings;            /* str_N labels */
+    ConstPool floats;             /* float_N labels */
 } CodeGenContext;
 
+/* function bodies are built as an instruction list over virtual registers
+   and printed once the register allocator has mapped them */
 typedef struct {
     CodeGenContext *cg;
     SymTable *scope;
+    X86Code code;
     char funcName[64];
-    char endLabel[64];
-    Symbol *funcSym;  /* function symbol for parameter lookup */
-    int callee_saved_used[3];  /* track which callee-saved regs are used: EBX(1), ESI(4), EDI(5) */
+    const char *endLabel;
+    TypeId returnType;
 } FunctionContext;
 
 static void cg_emit(CodeGenContext *cg, const char *fmt, ...) {
@@ -58,114 +57,146 @@ static void cg_emit(CodeGenContext *cg, const char *fmt, ...) {
 
 static void cg_init(CodeGenContext *cg, FILE *out) {
     cg->out = out;
-    for (int i = 0; i < REG_POOL; ++i) cg->available[i] = 1;
     cg->labelCounter = 0;
     cg->tempCounter = 0;
-    cg->available[0] = 0;
-}
-
-static const char *reg_name(int idx) {
-    if (idx < 0 || idx >= REG_POOL) return "EAX";  /* default to EAX */
-    return REG_NAMES[idx];
-}
-
-static int cg_alloc_reg_with_tracking(CodeGenContext *cg, FunctionContext *fn) {
-    /* prefer caller-saved registers first (EAX, ECX, EDX) */
-    int preferred[] = {0, 2, 3, 1, 4, 5};  /* EAX, ECX, EDX, EBX, ESI, EDI */
-    for (int i = 0; i < REG_POOL; ++i) {
-        int reg = preferred[i];
-        if (cg->available[reg]) {
-            cg->available[reg] = 0;
-            /* track callee-saved registers: EBX=1, ESI=4, EDI=5 */
-            if (fn && reg == 1) fn->callee_saved_used[0] = 1;  /* EBX */
-            else if (fn && reg == 4) fn->callee_saved_used[1] = 1;  /* ESI */
-            else if (fn && reg == 5) fn->callee_saved_used[2] = 1;  /* EDI */
-            return reg;
-        }
-    }
-    fprintf(stderr, "[codegen] register exhaustion - no register spilling implemented\n");
-    fprintf(stderr, "[codegen] This is a known limitation. Complex expressions may fail.\n");
-    exit(1);
+    cg->failed = 0;
+    memset(&cg->strings, 0, sizeof(cg->strings));
+    memset(&cg->floats, 0, sizeof(cg->floats));
 }
 
-static int cg_alloc_reg(CodeGenContext *cg) {
-    return cg_alloc_reg_with_tracking(cg, NULL);
+/* labels and comments are interned so the instruction list can point at them */
+static const char *cg_text(FunctionContext *fn, const char *fmt, ...) {
+    char buffer[256];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, ap);
+    va_end(ap);
+    return intern_str(fn->scope->names, intern_id(fn->scope->names, buffer));
 }
 
-static void cg_free_reg(CodeGenContext *cg, int reg) {
-    if (reg < 0 || reg >= REG_POOL) return;
-    cg->available[reg] = 1;
+static X86Insn *cg_op(FunctionContext *fn, X86Op op, X86Operand dst, X86Operand src) {
+    X86Insn *insn = x86_emit(&fn->code, op, dst, src);
+    if (!insn) fn->cg->failed = 1;
+    return insn;
 }
 
-static void cg_make_label(CodeGenContext *cg, char *buffer, size_t len, const char *prefix) {
-    snprintf(buffer, len, "%s_%03d", prefix, cg->labelCounter++);
+static X86Insn *cg_jump(FunctionContext *fn, X86Op op, X86Cond cond, const char *label) {
+    X86Insn *insn = cg_op(fn, op, x86_label(label), x86_none());
+    if (insn) insn->cond = cond;
+    return insn;
 }
 
-static Symbol *cg_lookup(FunctionContext *fn, const char *name) {
-    return symtable_lookup(fn->scope, name);
+static void cg_place_label(FunctionContext *fn, const char *label) {
+    cg_op(fn, X86_LABEL, x86_label(label), x86_none());
 }
 
-/* calculate x86 parameter offset: first param at EBP+8, second at EBP+12, etc. */
-static int get_param_offset(Symbol *funcSym, const char *paramName) {
-    if (!funcSym || !funcSym->params) return -1;
-    int paramIndex = 0;
-    for (Symbol *p = funcSym->params; p; p = p->next) {
-        if (p->name && strcmp(p->name, paramName) == 0) {
-            /* x86 cdecl: [EBP+4] = return address, [EBP+8] = first param */
-            return 8 + (paramIndex * WORD_SIZE);
-        }
-        paramIndex++;
-    }
-    return -1;
+static void cg_comment(X86Insn *insn, const char *comment) {
+    if (insn) insn->comment = comment;
 }
 
-static void cg_store_var(FunctionContext *fn, Symbol *sym, int reg) {
-    if (!sym) return;
+static const char *cg_make_label(FunctionContext *fn, const char *prefix) {
+    return cg_text(fn, "%s_%03d", prefix, fn->cg->labelCounter++);
+}
+
+/* identifiers carry the symbol semantic pass B resolved; anything it did not
+   visit is looked up in the function's scope */
+static Symbol *cg_lookup(FunctionContext *fn, const AST *id) {
+    if (!id) return NULL;
+    if (id->kind == NODE_ID && id->symbol) return id->symbol;
+    return id->nameId ? symtable_lookup(fn->scope, id->nameId) : NULL;
+}
+
+/* the memory a variable lives in and the comment naming it; 0 if it has none.
+   Doubles are QWORD operands. */
+static int cg_var_home(FunctionContext *fn, Symbol *sym, X86Operand *home, const char **comment) {
+    int isFloat = sym->type == TYPE_FLOAT;
     if (sym->kind == SYM_PARAM) {
-        int offset = get_param_offset(fn->funcSym, sym->name);
-        if (offset > 0) {
-            cg_emit(fn->cg, "    mov DWORD PTR [EBP+%d], %s    ; %s (parameter)\n", offset, reg_name(reg), sym->name);
-        }
+        if (sym->paramOffset <= 0) return 0;
+        *home = isFloat ? x86_mem_qword(X86_EBP, sym->paramOffset) : x86_mem(X86_EBP, sym->paramOffset);
+        *comment = cg_text(fn, "%s (parameter)", sym->name);
     } else if (sym->offset >= 0 && sym->kind != SYM_CLASS && sym->kind != SYM_FUNC) {
         /* local variable: negative offset from EBP */
-        cg_emit(fn->cg, "    mov DWORD PTR [EBP-%d], %s    ; %s (local)\n", sym->offset, reg_name(reg), sym->name);
+        *home = isFloat ? x86_mem_qword(X86_EBP, -sym->offset) : x86_mem(X86_EBP, -sym->offset);
+        *comment = cg_text(fn, "%s (local)", sym->name);
     } else {
         /* global variable: absolute address */
-        cg_emit(fn->cg, "    mov DWORD PTR [%s], %s    ; %s (global)\n", sym->name ? sym->name : "tmp", reg_name(reg), sym->name ? sym->name : "");
+        const char *name = sym->name ? sym->name : "tmp";
+        *home = isFloat ? x86_global_qword(name) : x86_global(name);
+        *comment = cg_text(fn, "%s (global)", sym->name ? sym->name : "");
     }
+    return 1;
 }
 
-static int cg_load_var(FunctionContext *fn, Symbol *sym) {
-    int reg = cg_alloc_reg_with_tracking(fn->cg, fn);
-    if (!sym) {
-        cg_emit(fn->cg, "    mov %s, 0\n", reg_name(reg));
-        return reg;
+static int is_float_expr(const AST *expr) {
+    return expr && expr->typeId == TYPE_FLOAT;
+}
+
+/* an integer value converted to a double; doubles pass through */
+static X86Operand cg_to_float(FunctionContext *fn, X86Operand value) {
+    if (x86_is_xmm(value)) return value;
+    X86Operand d = x86_new_xmm_vreg(&fn->code);
+    cg_op(fn, X86_CVTSI2SD, d, value);
+    return d;
+}
+
+static X86Operand cg_float_zero(FunctionContext *fn) {
+    X86Operand zero = x86_new_xmm_vreg(&fn->code);
+    cg_op(fn, X86_XORPD, zero, zero);
+    return zero;
+}
+
+static void cg_store_var(FunctionContext *fn, Symbol *sym, X86Operand value) {
+    X86Operand home;
+    const char *comment;
+    if (!sym || !cg_var_home(fn, sym, &home, &comment)) return;
+    if (sym->type == TYPE_FLOAT)
+        cg_comment(cg_op(fn, X86_MOVSD, home, cg_to_float(fn, value)), comment);
+    else
+        cg_comment(cg_op(fn, X86_MOV, home, value), comment);
+}
+
+static X86Operand cg_load_var(FunctionContext *fn, Symbol *sym) {
+    X86Operand home;
+    const char *comment;
+    if (sym && sym->type == TYPE_FLOAT && cg_var_home(fn, sym, &home, &comment)) {
+        X86Operand value = x86_new_xmm_vreg(&fn->code);
+        cg_comment(cg_op(fn, X86_MOVSD, value, home), comment);
+        return value;
     }
-    if (sym->kind == SYM_PARAM) {
-        int offset = get_param_offset(fn->funcSym, sym->name);
-        if (offset > 0) {
-            cg_emit(fn->cg, "    mov %s, DWORD PTR [EBP+%d]    ; %s (parameter)\n", reg_name(reg), offset, sym->name);
-        } else {
-            cg_emit(fn->cg, "    mov %s, 0    ; %s (param not found)\n", reg_name(reg), sym->name);
-        }
-    } else if (sym->offset >= 0 && sym->kind != SYM_CLASS && sym->kind != SYM_FUNC) {
-        /* local variable: negative offset from EBP */
-        cg_emit(fn->cg, "    mov %s, DWORD PTR [EBP-%d]    ; %s (local)\n", reg_name(reg), sym->offset, sym->name);
+    X86Operand value = x86_new_vreg(&fn->code);
+    if (!sym) {
+        cg_op(fn, X86_MOV, value, x86_imm(0));
+    } else if (!cg_var_home(fn, sym, &home, &comment)) {
+        cg_comment(cg_op(fn, X86_MOV, value, x86_imm(0)), cg_text(fn, "%s (param not found)", sym->name));
     } else {
-        /* global variable: absolute address */
-        cg_emit(fn->cg, "    mov %s, DWORD PTR [%s]    ; %s (global)\n", reg_name(reg), sym->name ? sym->name : "tmp", sym->name ? sym->name : "");
+        cg_comment(cg_op(fn, X86_MOV, value, home), comment);
     }
-    return reg;
+    return value;
+}
+
+/* cdecl passes doubles on the stack and returns them in ST(0) */
+static void cg_push_float(FunctionContext *fn, X86Operand value) {
+    cg_op(fn, X86_SUB, x86_reg(X86_ESP), x86_imm(8));
+    cg_op(fn, X86_MOVSD, x86_mem_qword(X86_ESP, 0), value);
+}
+
+static X86Operand cg_pop_st0(FunctionContext *fn) {
+    X86Operand value = x86_new_xmm_vreg(&fn->code);
+    cg_op(fn, X86_SUB, x86_reg(X86_ESP), x86_imm(8));
+    cg_comment(cg_op(fn, X86_FSTP, x86_mem_qword(X86_ESP, 0), x86_none()), "double result from ST(0)");
+    cg_op(fn, X86_MOVSD, value, x86_mem_qword(X86_ESP, 0));
+    cg_op(fn, X86_ADD, x86_reg(X86_ESP), x86_imm(8));
+    return value;
 }
 
 /* Forward declarations */
-static int cg_generate_expr(FunctionContext *fn, AST *expr);
+static X86Operand cg_generate_expr(FunctionContext *fn, AST *expr);
 static void cg_generate_statement(FunctionContext *fn, AST *stmt);
-static int get_string_index(const char *str);
-static int get_float_index(double value);
+static int pool_find(const ConstPool *pool, unsigned long long key);
+static unsigned long long float_key(double value);
 
 static void cg_generate_block(FunctionContext *fn, AST *list) {
-    for (AST *node = list; node; node = node->sibling) {
+    for (AST *node = list; node; node = ast_sibling(node)) {
         switch (node->kind) {
             case NODE_VAR_DECL:
             case NODE_ATTRIBUTE:
@@ -178,234 +209,440 @@ static void cg_generate_block(FunctionContext *fn, AST *list) {
     }
 }
 
-static void cg_emit_binary(FunctionContext *fn, const char *mnemonic, int lhsReg, int rhsReg) {
-    cg_emit(fn->cg, "    %s %s, %s\n", mnemonic, reg_name(lhsReg), reg_name(rhsReg));
-    cg_free_reg(fn->cg, rhsReg);
+/* push arguments right-to-left (x86 cdecl convention); returns the bytes pushed */
+static int cg_push_args(FunctionContext *fn, AST *arg) {
+    if (!arg) return 0;
+    int bytes = cg_push_args(fn, ast_sibling(arg));
+    X86Operand value = cg_generate_expr(fn, arg);
+    if (x86_is_xmm(value)) {
+        cg_push_float(fn, value);
+        return bytes + 8;
+    }
+    cg_op(fn, X86_PUSH, value, x86_none());
+    return bytes + WORD_SIZE;
+}
+
+static X86Operand cg_generate_function_call(FunctionContext *fn, AST *call) {
+    int argBytes = cg_push_args(fn, ast_child(call));
+    cg_op(fn, X86_CALL, x86_label(cg_text(fn, "_%s", ast_name(call) ? ast_name(call) : "anon")), x86_none());
+    if (argBytes > 0)
+        cg_comment(cg_op(fn, X86_ADD, x86_reg(X86_ESP), x86_imm(argBytes)), "clean up stack");
+    /* a double comes back in ST(0), which must be popped even if unused */
+    if (is_float_expr(call)) return cg_pop_st0(fn);
+    /* return value is in EAX (x86 convention) */
+    X86Operand target = x86_new_vreg(&fn->code);
+    cg_op(fn, X86_MOV, target, x86_reg(X86_EAX));
+    return target;
 }
 
-static int cg_generate_function_call(FunctionContext *fn, AST *call) {
-    int argCount = 0;
-    /* push arguments right-to-left (x86 cdecl convention) */
-    AST *args[64];
-    int argIdx = 0;
-    for (AST *arg = call->child; arg; arg = arg->sibling) {
-        args[argIdx++] = arg;
-        argCount++;
+/* setcc only writes a byte register, so comparisons go through AL */
+static void cg_set_bool(FunctionContext *fn, X86Cond cond, X86Operand target) {
+    X86Insn *set = cg_op(fn, X86_SETCC, x86_reg(X86_AL), x86_none());
+    if (set) set->cond = cond;
+    cg_op(fn, X86_MOVZX, target, x86_reg(X86_AL));
+}
+
+/* ucomisd reports below/above the way an unsigned compare does */
+static X86Cond relational_cond(OpCode op, int isFloat) {
+    switch (op) {
+        case OP_NE: return X86_CC_NE;
+        case OP_LT: return isFloat ? X86_CC_B : X86_CC_L;
+        case OP_GT: return isFloat ? X86_CC_A : X86_CC_G;
+        case OP_LE: return isFloat ? X86_CC_BE : X86_CC_LE;
+        case OP_GE: return isFloat ? X86_CC_AE : X86_CC_GE;
+        default:    return X86_CC_E;
     }
-    /* push in reverse order */
-    for (int i = argCount - 1; i >= 0; i--) {
-        int r = cg_generate_expr(fn, args[i]);
-        cg_emit(fn->cg, "    push %s\n", reg_name(r));
-        cg_free_reg(fn->cg, r);
+}
+
+/* Sethi-Ullman label: registers needed to evaluate expr without spilling.
+   A call clobbers the caller-saved registers, so it counts as needing the
+   whole pool. Operator nodes memoize the label. */
+static int cg_reg_need(AST *expr, int *hasCall) {
+    *hasCall = 0;
+    if (!expr) return 1;
+    switch (expr->kind) {
+        case NODE_BINARY_OP:
+        case NODE_UNARY_OP:
+            if (!expr->regNeed) {
+                int lc, rc = 0, need;
+                int l = cg_reg_need(ast_child(expr), &lc);
+                if (expr->kind == NODE_BINARY_OP) {
+                    int r = cg_reg_need(ast_child(expr) ? ast_sibling(ast_child(expr)) : NULL, &rc);
+                    need = l == r ? l + 1 : (l > r ? l : r);
+                } else {
+                    need = l;
+                }
+                expr->regNeed = (unsigned short)need;
+                expr->hasCall = (unsigned short)(lc || rc);
+            }
+            *hasCall = expr->hasCall;
+            return expr->regNeed;
+        case NODE_FUNCTION_CALL: {
+            int need = REGALLOC_POOL_SIZE;
+            for (AST *arg = ast_child(expr); arg; arg = ast_sibling(arg)) {
+                int c, n = cg_reg_need(arg, &c);
+                if (n > need) need = n;
+            }
+            *hasCall = 1;
+            return need;
+        }
+        default:
+            return 1;
     }
-    cg_emit(fn->cg, "    call _%s\n", call->name ? call->name : "anon");
-    if (argCount > 0)
-        cg_emit(fn->cg, "    add ESP, %d    ; clean up stack\n", argCount * WORD_SIZE);
-    int target = cg_alloc_reg_with_tracking(fn->cg, fn);
-    /* return value is in EAX (x86 convention) */
-    if (target != 0) {
-        cg_emit(fn->cg, "    mov %s, EAX\n", reg_name(target));
+}
+
+static X86Cond negate_cond(X86Cond cond) {
+    switch (cond) {
+        case X86_CC_E:  return X86_CC_NE;
+        case X86_CC_NE: return X86_CC_E;
+        case X86_CC_L:  return X86_CC_GE;
+        case X86_CC_GE: return X86_CC_L;
+        case X86_CC_G:  return X86_CC_LE;
+        case X86_CC_LE: return X86_CC_G;
+        case X86_CC_Z:  return X86_CC_NZ;
+        case X86_CC_B:  return X86_CC_AE;
+        case X86_CC_AE: return X86_CC_B;
+        case X86_CC_A:  return X86_CC_BE;
+        case X86_CC_BE: return X86_CC_A;
+        default:        return X86_CC_Z;
     }
-    return target;
 }
 
-static int cg_generate_expr(FunctionContext *fn, AST *expr) {
+/* the condition that holds for (b op a) when it holds for (a op b) */
+static X86Cond mirror_cond(X86Cond cond) {
+    switch (cond) {
+        case X86_CC_L:  return X86_CC_G;
+        case X86_CC_G:  return X86_CC_L;
+        case X86_CC_LE: return X86_CC_GE;
+        case X86_CC_GE: return X86_CC_LE;
+        case X86_CC_B:  return X86_CC_A;
+        case X86_CC_A:  return X86_CC_B;
+        case X86_CC_BE: return X86_CC_AE;
+        case X86_CC_AE: return X86_CC_BE;
+        default:        return cond;
+    }
+}
+
+/* evaluates both operands of a binary operator, the more demanding one first
+   so the other one's value is not held across it; only when no call could
+   observe the order. Returns 1 if the right operand went first. */
+static int cg_generate_operands(FunctionContext *fn, AST *expr, X86Operand *left, X86Operand *right) {
+    AST *lhs = ast_child(expr);
+    AST *rhs = lhs ? ast_sibling(lhs) : NULL;
+    int lc, rc;
+    int rightFirst = cg_reg_need(rhs, &rc) > cg_reg_need(lhs, &lc) && !lc && !rc;
+    if (rightFirst) {
+        *right = cg_generate_expr(fn, rhs);
+        *left = cg_generate_expr(fn, lhs);
+    } else {
+        *left = cg_generate_expr(fn, lhs);
+        *right = cg_generate_expr(fn, rhs);
+    }
+    return rightFirst;
+}
+
+/* multiplier and shift for signed division by d >= 2 that is not a power
+   of two (Hacker's Delight, 10-1): the quotient is the high half of
+   n * magic, plus n if magic came out negative, shifted right by shift and
+   rounded toward zero */
+static void signed_magic(unsigned int d, int *magic, int *shift) {
+    const unsigned int two31 = 0x80000000u;
+    unsigned int anc = two31 - 1 - two31 % d;
+    unsigned int q1 = two31 / anc, r1 = two31 - q1 * anc;
+    unsigned int q2 = two31 / d, r2 = two31 - q2 * d;
+    unsigned int delta;
+    int p = 31;
+    do {
+        p++;
+        q1 *= 2; r1 *= 2;
+        if (r1 >= anc) { q1++; r1 -= anc; }
+        q2 *= 2; r2 *= 2;
+        if (r2 >= d) { q2++; r2 -= d; }
+        delta = d - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    *magic = (int)(q2 + 1);
+    *shift = p - 32;
+}
+
+/* log2 of a power of two, -1 for anything else */
+static int power_of_two(unsigned int u) {
+    if (u == 0 || (u & (u - 1))) return -1;
+    int k = 0;
+    while (u >>= 1) k++;
+    return k;
+}
+
+static X86Operand cg_mul_const(FunctionContext *fn, X86Operand v, int c) {
+    unsigned int u = c < 0 ? 0u - (unsigned int)c : (unsigned int)c;
+    int k = power_of_two(u);
+    if (c == 0) {
+        /* a fresh register leaves v's load dead for the peephole pass */
+        X86Operand zero = x86_new_vreg(&fn->code);
+        cg_op(fn, X86_MOV, zero, x86_imm(0));
+        return zero;
+    }
+    if (k < 0) {
+        cg_op(fn, X86_IMUL, v, x86_imm(c));
+        return v;
+    }
+    if (k > 0)
+        cg_comment(cg_op(fn, X86_SHL, v, x86_imm(k)), cg_text(fn, "* %u", u));
+    if (c < 0) cg_op(fn, X86_NEG, v, x86_none());
+    return v;
+}
+
+/* signed division by a non-zero constant, truncating like idiv */
+static X86Operand cg_div_const(FunctionContext *fn, X86Operand v, int c) {
+    unsigned int u = c < 0 ? 0u - (unsigned int)c : (unsigned int)c;
+    int k = power_of_two(u);
+    if (k > 0) {
+        /* a negative dividend is biased by 2^k - 1 so the shift rounds toward zero */
+        X86Operand bias = x86_new_vreg(&fn->code);
+        cg_op(fn, X86_MOV, bias, v);
+        if (k > 1) cg_op(fn, X86_SAR, bias, x86_imm(31));
+        cg_op(fn, X86_SHR, bias, x86_imm(32 - k));
+        cg_op(fn, X86_ADD, v, bias);
+        cg_comment(cg_op(fn, X86_SAR, v, x86_imm(k)), cg_text(fn, "/ %u", u));
+    } else if (k < 0) {
+        int magic, shift;
+        signed_magic(u, &magic, &shift);
+        X86Operand q = x86_new_vreg(&fn->code);
+        X86Operand sign = x86_new_vreg(&fn->code);
+        cg_op(fn, X86_MOV, x86_reg(X86_EAX), x86_imm(magic));
+        cg_comment(cg_op(fn, X86_IMUL_WIDE, v, x86_none()), "EDX:EAX = n * magic");
+        cg_op(fn, X86_MOV, q, x86_reg(X86_EDX));
+        if (magic < 0) cg_op(fn, X86_ADD, q, v);
+        if (shift > 0) cg_op(fn, X86_SAR, q, x86_imm(shift));
+        /* add one to a negative quotient to round toward zero */
+        cg_op(fn, X86_MOV, sign, q);
+        cg_op(fn, X86_SHR, sign, x86_imm(31));
+        cg_comment(cg_op(fn, X86_ADD, q, sign), cg_text(fn, "/ %u", u));
+        v = q;
+    }
+    if (c < 0) cg_op(fn, X86_NEG, v, x86_none());
+    return v;
+}
+
+/* x * c, c * x and x / c with an integer literal c skip mul/idiv; division
+   by zero is left to idiv */
+static int cg_generate_by_constant(FunctionContext *fn, AST *expr, X86Operand *result) {
+    AST *lhs = ast_child(expr);
+    AST *rhs = lhs ? ast_sibling(lhs) : NULL;
+    AST *other;
+    int c;
+    if (rhs && rhs->kind == NODE_INT_LITERAL && (expr->op == OP_MUL || rhs->intValue != 0)) {
+        other = lhs;
+        c = rhs->intValue;
+    } else if (expr->op == OP_MUL && lhs && lhs->kind == NODE_INT_LITERAL) {
+        other = rhs;
+        c = lhs->intValue;
+    } else {
+        return 0;
+    }
+    X86Operand v = cg_generate_expr(fn, other);
+    *result = expr->op == OP_MUL ? cg_mul_const(fn, v, c) : cg_div_const(fn, v, c);
+    return 1;
+}
+
+static int is_relational(OpCode op) {
+    return op == OP_EQ || op == OP_NE || op == OP_LT || op == OP_GT || op == OP_LE || op == OP_GE;
+}
+
+static int is_float_compare(const AST *expr) {
+    AST *lhs = ast_child(expr);
+    return is_relational(expr->op) && (is_float_expr(lhs) || is_float_expr(lhs ? ast_sibling(lhs) : NULL));
+}
+
+/* compares expr's operands and returns the condition that holds when the
+   relation is true; doubles are compared with ucomisd, an int side converted */
+static X86Cond cg_generate_compare(FunctionContext *fn, AST *expr) {
+    X86Operand left, right;
+    int isFloat = is_float_compare(expr);
+    X86Cond cond = relational_cond(expr->op, isFloat);
+    int rightFirst = cg_generate_operands(fn, expr, &left, &right);
+    if (isFloat) {
+        left = cg_to_float(fn, left);
+        right = cg_to_float(fn, right);
+    }
+    X86Op cmp = isFloat ? X86_UCOMISD : X86_CMP;
+    if (rightFirst) {
+        cg_op(fn, cmp, right, left);
+        return mirror_cond(cond);
+    }
+    cg_op(fn, cmp, left, right);
+    return cond;
+}
+
+/* arithmetic on doubles and comparisons involving one */
+static X86Operand cg_generate_float_op(FunctionContext *fn, AST *expr) {
+    if (is_relational(expr->op)) {
+        X86Cond cond = cg_generate_compare(fn, expr);
+        X86Operand result = x86_new_vreg(&fn->code);
+        cg_set_bool(fn, cond, result);
+        return result;
+    }
+    X86Operand left, right;
+    int rightFirst = cg_generate_operands(fn, expr, &left, &right);
+    left = cg_to_float(fn, left);
+    right = cg_to_float(fn, right);
+    X86Op op;
+    switch (expr->op) {
+        case OP_SUB: op = X86_SUBSD; break;
+        case OP_MUL: op = X86_MULSD; break;
+        case OP_DIV: op = X86_DIVSD; break;
+        default:     op = X86_ADDSD; break;
+    }
+    if (rightFirst && (op == X86_ADDSD || op == X86_MULSD)) {
+        cg_op(fn, op, right, left);
+        return right;
+    }
+    cg_op(fn, op, left, right);
+    return left;
+}
+
+/* short-circuit and/or as a value: the right operand's code is only reached
+   when the left one does not decide the result. A deciding left operand is
+   the result as is; otherwise the result is 1 if the right operand is non-zero */
+static X86Operand cg_generate_logical(FunctionContext *fn, AST *expr) {
+    AST *lhs = ast_child(expr);
+    int isAnd = expr->op == OP_AND;
+    const char *end = cg_make_label(fn, isAnd ? "L_and_end" : "L_or_end");
+    X86Operand left = cg_generate_expr(fn, lhs);
+    cg_op(fn, X86_TEST, left, left);
+    cg_comment(cg_jump(fn, X86_JCC, isAnd ? X86_CC_Z : X86_CC_NZ, end),
+               isAnd ? "short-circuit: skip right if left is false" : "short-circuit: skip right if left is true");
+    X86Operand right = cg_generate_expr(fn, lhs ? ast_sibling(lhs) : NULL);
+    cg_op(fn, X86_TEST, right, right);
+    cg_set_bool(fn, X86_CC_NZ, left);
+    cg_place_label(fn, end);
+    return left;
+}
+
+static X86Operand cg_generate_expr(FunctionContext *fn, AST *expr) {
     if (!expr) {
-        int r = cg_alloc_reg_with_tracking(fn->cg, fn);
-        cg_emit(fn->cg, "    mov %s, 0\n", reg_name(r));
+        X86Operand r = x86_new_vreg(&fn->code);
+        cg_op(fn, X86_MOV, r, x86_imm(0));
         return r;
     }
 
     switch (expr->kind) {
         case NODE_ID: {
-            Symbol *sym = cg_lookup(fn, expr->name);
+            Symbol *sym = cg_lookup(fn, expr);
             return cg_load_var(fn, sym);
         }
         case NODE_INT_LITERAL: {
-            int r = cg_alloc_reg_with_tracking(fn->cg, fn);
-            cg_emit(fn->cg, "    mov %s, %d\n", reg_name(r), expr->intValue);
+            X86Operand r = x86_new_vreg(&fn->code);
+            cg_op(fn, X86_MOV, r, x86_imm(expr->intValue));
             return r;
         }
         case NODE_FLOAT_LITERAL: {
-            /* use x87 FPU for float literals - store in .data section and load via FPU */
-            int float_idx = get_float_index(expr->floatValue);
-            int r = cg_alloc_reg_with_tracking(fn->cg, fn);
-            /* load float from .data section using FPU */
-            cg_emit(fn->cg, "    fld QWORD PTR [float_%d]    ; load float: %f\n", float_idx, expr->floatValue);
-            /* store float to memory temporarily (8 bytes for double precision) */
-            cg_emit(fn->cg, "    sub ESP, 8    ; allocate space for float\n");
-            cg_emit(fn->cg, "    fstp QWORD PTR [ESP]    ; store float to stack\n");
-            /* for compatibility with integer-based codegen, we need integer representation */
-            /* however, we preserve the float value in memory and use FPU for operations */
-            /* load the lower 32 bits as integer representation (this is a limitation) */
-            cg_emit(fn->cg, "    mov %s, DWORD PTR [ESP]    ; load float bits (lower 32 bits)\n", reg_name(r));
-            cg_emit(fn->cg, "    add ESP, 8    ; clean up stack\n");
-            /* NOTE: This is still not ideal - proper float support requires FPU stack throughout */
-            /* the float value is loaded correctly via FPU, but we extract integer bits for compatibility */
-            /* full FPU support would require refactoring codegen to track float types and use FPU stack */
+            /* doubles live in XMM registers; literals are loaded from the .data section */
+            int float_idx = pool_find(&fn->cg->floats, float_key(expr->floatValue));
+            X86Operand r = x86_new_xmm_vreg(&fn->code);
+            if (float_idx >= 0) {
+                cg_comment(cg_op(fn, X86_MOVSD, r, x86_global_qword(cg_text(fn, "float_%d", float_idx))),
+                           cg_text(fn, "float literal: %g", expr->floatValue));
+            } else {
+                cg_comment(cg_op(fn, X86_XORPD, r, r), "float literal not found in .data section");
+            }
             return r;
         }
         case NODE_STRING_LITERAL: {
-            int r = cg_alloc_reg_with_tracking(fn->cg, fn);
-            int str_idx = get_string_index(expr->name ? expr->name : "");
+            X86Operand r = x86_new_vreg(&fn->code);
+            int str_idx = pool_find(&fn->cg->strings, expr->nameId);
             if (str_idx >= 0) {
-                cg_emit(fn->cg, "    mov %s, OFFSET str_%d    ; string literal: \"%s\"\n", 
-                        reg_name(r), str_idx, expr->name ? expr->name : "");
+                cg_comment(cg_op(fn, X86_MOV, r, x86_offset(cg_text(fn, "str_%d", str_idx))),
+                           cg_text(fn, "string literal: \"%s\"", ast_name(expr) ? ast_name(expr) : ""));
             } else {
                 /* fallback if not found in mapping */
-                cg_emit(fn->cg, "    mov %s, 0    ; string literal not found in .data section\n", reg_name(r));
+                cg_comment(cg_op(fn, X86_MOV, r, x86_imm(0)), "string literal not found in .data section");
             }
             return r;
         }
         case NODE_BINARY_OP: {
-            int left = cg_generate_expr(fn, expr->child);
-            int right = cg_generate_expr(fn, expr->child ? expr->child->sibling : NULL);
-            const char *op = expr->name ? expr->name : "";
-            if (strcmp(op, "+") == 0) {
-                cg_emit_binary(fn, "add", left, right);
-            } else if (strcmp(op, "-") == 0) {
-                cg_emit_binary(fn, "sub", left, right);
-            } else if (strcmp(op, "*") == 0) {
-                /* x86 mul uses EAX:EDX - mul multiplies EAX by operand, result in EDX:EAX */
-                /* check if EAX is already allocated - if so, save it */
-                int eax_was_allocated = !fn->cg->available[0];
-                if (eax_was_allocated) {
-                    /* save EAX to stack temporarily */
-                    cg_emit(fn->cg, "    push EAX    ; save EAX before mul\n");
-                }
-                /* free EAX if it was allocated */
-                if (eax_was_allocated) {
-                    fn->cg->available[0] = 1;
-                }
-                /* move left operand to EAX, push right operand, then multiply */
-                cg_emit(fn->cg, "    mov EAX, %s\n", reg_name(left));
-                cg_emit(fn->cg, "    push %s\n", reg_name(right));
-                cg_emit(fn->cg, "    mul DWORD PTR [ESP]    ; EAX = EAX * [ESP]\n");
-                cg_emit(fn->cg, "    add ESP, 4    ; clean up stack\n");
-                cg_free_reg(fn->cg, right);
-                /* result is in EAX, move to target register if needed */
-                if (left != 0) {
-                    cg_emit(fn->cg, "    mov %s, EAX\n", reg_name(left));
-                    /* restore EAX if it was allocated before */
-                    if (eax_was_allocated) {
-                        cg_emit(fn->cg, "    pop EAX    ; restore EAX after mul\n");
-                        fn->cg->available[0] = 0;  /* mark EAX as allocated again */
-                    }
-                } else {
-                    /* if left was EAX, it's already there */
-                    left = 0;  /* EAX is register 0 */
-                    fn->cg->available[0] = 0;  /* Mark EAX as allocated */
-                    /* restore EAX if it was allocated before (but now result is in EAX) */
-                    if (eax_was_allocated) {
-                        /* the old EAX value is lost - this is a limitation */
-                        cg_emit(fn->cg, "    add ESP, 4    ; discard saved EAX (result now in EAX)\n");
-                    }
-                }
-            } else if (strcmp(op, "/") == 0) {
-                /* x86 idiv uses EDX:EAX / operand, quotient in EAX, remainder in EDX */
-                /* check if EAX is already allocated - if so, save it */
-                int eax_was_allocated = !fn->cg->available[0];
-                if (eax_was_allocated) {
-                    /* save EAX to stack temporarily */
-                    cg_emit(fn->cg, "    push EAX    ; save EAX before idiv\n");
-                }
-                /* free EAX if it was allocated */
-                if (eax_was_allocated) {
-                    fn->cg->available[0] = 1;
-                }
-                /* move left operand to EAX, sign extend, push right operand, then divide */
-                cg_emit(fn->cg, "    mov EAX, %s\n", reg_name(left));
-                cg_emit(fn->cg, "    cdq    ; sign extend EAX to EDX:EAX\n");
-                cg_emit(fn->cg, "    push %s\n", reg_name(right));
-                cg_emit(fn->cg, "    idiv DWORD PTR [ESP]    ; EAX = EDX:EAX / [ESP]\n");
-                cg_emit(fn->cg, "    add ESP, 4    ; clean up stack\n");
-                cg_free_reg(fn->cg, right);
-                /* quotient is in EAX, move to target register if needed */
-                if (left != 0) {
-                    cg_emit(fn->cg, "    mov %s, EAX\n", reg_name(left));
-                    /* restore EAX if it was allocated before */
-                    if (eax_was_allocated) {
-                        cg_emit(fn->cg, "    pop EAX    ; restore EAX after idiv\n");
-                        fn->cg->available[0] = 0;  /* mark EAX as allocated again */
+            if (expr->op == OP_AND || expr->op == OP_OR)
+                return cg_generate_logical(fn, expr);
+            if (is_float_expr(expr) || is_float_compare(expr))
+                return cg_generate_float_op(fn, expr);
+            if (expr->op == OP_MUL || expr->op == OP_DIV) {
+                X86Operand result;
+                if (cg_generate_by_constant(fn, expr, &result)) return result;
+            }
+            X86Operand left, right;
+            int rightFirst = cg_generate_operands(fn, expr, &left, &right);
+            switch (expr->op) {
+                case OP_ADD:
+                    if (rightFirst) {
+                        /* commutative: accumulate into the operand computed first */
+                        cg_op(fn, X86_ADD, right, left);
+                        return right;
                     }
-                } else {
-                    /* if left was EAX, it's already there */
-                    left = 0;  /* EAX is register 0 */
-                    fn->cg->available[0] = 0;  /* mark EAX as allocated */
-                    /* restore EAX if it was allocated before (but now result is in EAX) */
-                    if (eax_was_allocated) {
-                        /* the old EAX value is lost - this is a limitation */
-                        cg_emit(fn->cg, "    add ESP, 4    ; discard saved EAX (result now in EAX)\n");
+                    cg_op(fn, X86_ADD, left, right);
+                    break;
+                case OP_SUB:
+                    cg_op(fn, X86_SUB, left, right);
+                    break;
+                case OP_MUL:
+                    /* x86 mul uses EAX:EDX - mul multiplies EAX by operand, result in EDX:EAX;
+                       EAX is never allocated, and the allocator keeps EDX clear of live values */
+                    cg_op(fn, X86_MOV, x86_reg(X86_EAX), left);
+                    cg_op(fn, X86_PUSH, right, x86_none());
+                    cg_comment(cg_op(fn, X86_MUL, x86_mem(X86_ESP, 0), x86_none()), "EAX = EAX * [ESP]");
+                    cg_comment(cg_op(fn, X86_ADD, x86_reg(X86_ESP), x86_imm(4)), "clean up stack");
+                    cg_op(fn, X86_MOV, left, x86_reg(X86_EAX));
+                    break;
+                case OP_DIV:
+                    /* x86 idiv uses EDX:EAX / operand, quotient in EAX, remainder in EDX */
+                    cg_op(fn, X86_MOV, x86_reg(X86_EAX), left);
+                    cg_comment(cg_op(fn, X86_CDQ, x86_none(), x86_none()), "sign extend EAX to EDX:EAX");
+                    cg_op(fn, X86_PUSH, right, x86_none());
+                    cg_comment(cg_op(fn, X86_IDIV, x86_mem(X86_ESP, 0), x86_none()), "EAX = EDX:EAX / [ESP]");
+                    cg_comment(cg_op(fn, X86_ADD, x86_reg(X86_ESP), x86_imm(4)), "clean up stack");
+                    cg_op(fn, X86_MOV, left, x86_reg(X86_EAX));
+                    break;
+                case OP_EQ:
+                case OP_NE:
+                case OP_LT:
+                case OP_GT:
+                case OP_LE:
+                case OP_GE:
+                    if (rightFirst) {
+                        cg_op(fn, X86_CMP, right, left);
+                        cg_set_bool(fn, mirror_cond(relational_cond(expr->op, 0)), right);
+                        return right;
                     }
-                }
-            } else if (strcmp(op, "and") == 0 || strcmp(op, "&&") == 0) {
-                /* short-circuit AND: if left is false, skip right evaluation */
-                char short_circuit_end[64];
-                cg_make_label(fn->cg, short_circuit_end, sizeof(short_circuit_end), "L_and_end");
-                /* test left operand */
-                cg_emit(fn->cg, "    test %s, %s\n", reg_name(left), reg_name(left));
-                cg_emit(fn->cg, "    jz %s    ; short-circuit: skip right if left is false\n", short_circuit_end);
-                /* left is true, evaluate right */
-                cg_emit(fn->cg, "    test %s, %s\n", reg_name(right), reg_name(right));
-                cg_emit(fn->cg, "    setnz AL\n");
-                cg_emit(fn->cg, "    movzx %s, AL\n", reg_name(left));
-                cg_emit(fn->cg, "%s:\n", short_circuit_end);
-                cg_free_reg(fn->cg, right);
-            } else if (strcmp(op, "or") == 0 || strcmp(op, "||") == 0) {
-                /* short-circuit OR: if left is true, skip right evaluation */
-                char short_circuit_end[64];
-                cg_make_label(fn->cg, short_circuit_end, sizeof(short_circuit_end), "L_or_end");
-                /* test left operand */
-                cg_emit(fn->cg, "    test %s, %s\n", reg_name(left), reg_name(left));
-                cg_emit(fn->cg, "    jnz %s    ; short-circuit: skip right if left is true\n", short_circuit_end);
-                /* left is false, evaluate right */
-                cg_emit(fn->cg, "    test %s, %s\n", reg_name(right), reg_name(right));
-                cg_emit(fn->cg, "    setnz AL\n");
-                cg_emit(fn->cg, "    movzx %s, AL\n", reg_name(left));
-                cg_emit(fn->cg, "%s:\n", short_circuit_end);
-                cg_free_reg(fn->cg, right);
-            } else if (strcmp(op, "==") == 0) {
-                cg_emit(fn->cg, "    cmp %s, %s\n", reg_name(left), reg_name(right));
-                cg_emit(fn->cg, "    sete AL\n");
-                cg_emit(fn->cg, "    movzx %s, AL\n", reg_name(left));
-                cg_free_reg(fn->cg, right);
-            } else if (strcmp(op, "<>") == 0 || strcmp(op, "!=") == 0) {
-                cg_emit(fn->cg, "    cmp %s, %s\n", reg_name(left), reg_name(right));
-                cg_emit(fn->cg, "    setne AL\n");
-                cg_emit(fn->cg, "    movzx %s, AL\n", reg_name(left));
-                cg_free_reg(fn->cg, right);
-            } else if (strcmp(op, "<") == 0) {
-                cg_emit(fn->cg, "    cmp %s, %s\n", reg_name(left), reg_name(right));
-                cg_emit(fn->cg, "    setl AL\n");
-                cg_emit(fn->cg, "    movzx %s, AL\n", reg_name(left));
-                cg_free_reg(fn->cg, right);
-            } else if (strcmp(op, ">") == 0) {
-                cg_emit(fn->cg, "    cmp %s, %s\n", reg_name(left), reg_name(right));
-                cg_emit(fn->cg, "    setg AL\n");
-                cg_emit(fn->cg, "    movzx %s, AL\n", reg_name(left));
-                cg_free_reg(fn->cg, right);
-            } else if (strcmp(op, "<=") == 0) {
-                cg_emit(fn->cg, "    cmp %s, %s\n", reg_name(left), reg_name(right));
-                cg_emit(fn->cg, "    setle AL\n");
-                cg_emit(fn->cg, "    movzx %s, AL\n", reg_name(left));
-                cg_free_reg(fn->cg, right);
-            } else if (strcmp(op, ">=") == 0) {
-                cg_emit(fn->cg, "    cmp %s, %s\n", reg_name(left), reg_name(right));
-                cg_emit(fn->cg, "    setge AL\n");
-                cg_emit(fn->cg, "    movzx %s, AL\n", reg_name(left));
-                cg_free_reg(fn->cg, right);
-            } else {
-                cg_emit_binary(fn, "add", left, right);
+                    cg_op(fn, X86_CMP, left, right);
+                    cg_set_bool(fn, relational_cond(expr->op, 0), left);
+                    break;
+                default:
+                    cg_op(fn, X86_ADD, left, right);
+                    break;
             }
             return left;
         }
         case NODE_UNARY_OP: {
-            int inner = cg_generate_expr(fn, expr->child);
-            const char *op = expr->name ? expr->name : "";
-            if (strcmp(op, "not") == 0) {
-                cg_emit(fn->cg, "    not %s    ; logical not\n", reg_name(inner));
-            } else if (strcmp(op, "-") == 0) {
-                cg_emit(fn->cg, "    neg %s    ; negate\n", reg_name(inner));
+            X86Operand inner = cg_generate_expr(fn, ast_child(expr));
+            switch (expr->op) {
+                case OP_NOT:
+                    cg_comment(cg_op(fn, X86_NOT, inner, x86_none()), "logical not");
+                    break;
+                case OP_NEG:
+                    if (x86_is_xmm(inner)) {
+                        /* flip the sign bit, so -(0.0) is -0.0 */
+                        int mask_idx = pool_find(&fn->cg->floats, float_key(-0.0));
+                        if (mask_idx < 0) {
+                            fn->cg->failed = 1;
+                            return inner;
+                        }
+                        X86Operand mask = x86_new_xmm_vreg(&fn->code);
+                        cg_op(fn, X86_MOVSD, mask, x86_global_qword(cg_text(fn, "float_%d", mask_idx)));
+                        cg_comment(cg_op(fn, X86_XORPD, inner, mask), "negate");
+                        return inner;
+                    }
+                    cg_comment(cg_op(fn, X86_NEG, inner, x86_none()), "negate");
+                    break;
+                default:
+                    break;
             }
             return inner;
         }
@@ -415,59 +652,82 @@ static int cg_generate_expr(FunctionContext *fn, AST *expr) {
             break;
     }
 
-    int r = cg_alloc_reg_with_tracking(fn->cg, fn);
-    cg_emit(fn->cg, "    mov %s, 0\n", reg_name(r));
+    X86Operand r = x86_new_vreg(&fn->code);
+    cg_op(fn, X86_MOV, r, x86_imm(0));
     return r;
 }
 
+/* jumps to label when expr's truth equals jumpIfTrue and falls through
+   otherwise; comparisons branch on the flags and and/or short-circuit
+   without materializing a value */
+static void cg_generate_branch(FunctionContext *fn, AST *expr, int jumpIfTrue, const char *label) {
+    if (expr && expr->kind == NODE_BINARY_OP && is_relational(expr->op)) {
+        X86Cond cond = cg_generate_compare(fn, expr);
+        cg_jump(fn, X86_JCC, jumpIfTrue ? cond : negate_cond(cond), label);
+    } else if (expr && expr->kind == NODE_BINARY_OP && (expr->op == OP_AND || expr->op == OP_OR)) {
+        AST *lhs = ast_child(expr);
+        AST *rhs = lhs ? ast_sibling(lhs) : NULL;
+        /* and jumps on a false left operand, or on a true one */
+        int decidesOn = expr->op == OP_OR;
+        if (jumpIfTrue == decidesOn) {
+            cg_generate_branch(fn, lhs, jumpIfTrue, label);
+            cg_generate_branch(fn, rhs, jumpIfTrue, label);
+        } else {
+            const char *skip = cg_make_label(fn, expr->op == OP_AND ? "L_and_end" : "L_or_end");
+            cg_generate_branch(fn, lhs, decidesOn, skip);
+            cg_generate_branch(fn, rhs, jumpIfTrue, label);
+            cg_place_label(fn, skip);
+        }
+    } else {
+        X86Operand value = cg_generate_expr(fn, expr);
+        if (x86_is_xmm(value))
+            cg_op(fn, X86_UCOMISD, value, cg_float_zero(fn));
+        else
+            cg_op(fn, X86_TEST, value, value);
+        cg_jump(fn, X86_JCC, jumpIfTrue ? X86_CC_NZ : X86_CC_Z, label);
+    }
+}
+
 static void cg_generate_if(FunctionContext *fn, AST *node) {
-    char elseLabel[64], endLabel[64];
-    cg_make_label(fn->cg, elseLabel, sizeof(elseLabel), "L_if_else");
-    cg_make_label(fn->cg, endLabel, sizeof(endLabel), "L_if_end");
+    const char *elseLabel = cg_make_label(fn, "L_if_else");
+    const char *endLabel = cg_make_label(fn, "L_if_end");
 
-    int condReg = cg_generate_expr(fn, node->child);
-    cg_emit(fn->cg, "    test %s, %s\n", reg_name(condReg), reg_name(condReg));
-    cg_emit(fn->cg, "    jz %s\n", elseLabel);
-    cg_free_reg(fn->cg, condReg);
+    cg_generate_branch(fn, ast_child(node), 0, elseLabel);
 
-    AST *thenBlock = node->child ? node->child->sibling : NULL;
-    AST *elseBlock = thenBlock ? thenBlock->sibling : NULL;
-    cg_generate_block(fn, thenBlock);
-    cg_emit(fn->cg, "    jmp %s\n", endLabel);
+    AST *thenBlock = ast_child(node) ? ast_sibling(ast_child(node)) : NULL;
+    AST *elseBlock = thenBlock ? ast_sibling(thenBlock) : NULL;
+    /* one block each: the then block's sibling is the else block */
+    cg_generate_statement(fn, thenBlock);
+    cg_jump(fn, X86_JMP, X86_CC_E, endLabel);
 
-    cg_emit(fn->cg, "%s:\n", elseLabel);
-    cg_generate_block(fn, elseBlock);
+    cg_place_label(fn, elseLabel);
+    cg_generate_statement(fn, elseBlock);
 
-    cg_emit(fn->cg, "%s:\n", endLabel);
+    cg_place_label(fn, endLabel);
 }
 
 static void cg_generate_while(FunctionContext *fn, AST *node) {
-    char topLabel[64], endLabel[64];
-    cg_make_label(fn->cg, topLabel, sizeof(topLabel), "L_while_top");
-    cg_make_label(fn->cg, endLabel, sizeof(endLabel), "L_while_end");
+    const char *topLabel = cg_make_label(fn, "L_while_top");
+    const char *endLabel = cg_make_label(fn, "L_while_end");
 
-    cg_emit(fn->cg, "%s:\n", topLabel);
-    int condReg = cg_generate_expr(fn, node->child);
-    cg_emit(fn->cg, "    test %s, %s\n", reg_name(condReg), reg_name(condReg));
-    cg_emit(fn->cg, "    jz %s\n", endLabel);
-    cg_free_reg(fn->cg, condReg);
+    cg_place_label(fn, topLabel);
+    cg_generate_branch(fn, ast_child(node), 0, endLabel);
 
-    AST *body = node->child ? node->child->sibling : NULL;
+    AST *body = ast_child(node) ? ast_sibling(ast_child(node)) : NULL;
     cg_generate_block(fn, body);
-    cg_emit(fn->cg, "    jmp %s\n", topLabel);
-    cg_emit(fn->cg, "%s:\n", endLabel);
+    cg_jump(fn, X86_JMP, X86_CC_E, topLabel);
+    cg_place_label(fn, endLabel);
 }
 
 static void cg_generate_statement(FunctionContext *fn, AST *stmt) {
     if (!stmt) return;
     switch (stmt->kind) {
         case NODE_ASSIGN: {
-            AST *lhs = stmt->child;
-            AST *rhs = lhs ? lhs->sibling : NULL;
-            Symbol *sym = cg_lookup(fn, lhs ? lhs->name : NULL);
-            int r = cg_generate_expr(fn, rhs);
+            AST *lhs = ast_child(stmt);
+            AST *rhs = lhs ? ast_sibling(lhs) : NULL;
+            Symbol *sym = cg_lookup(fn, lhs);
+            X86Operand r = cg_generate_expr(fn, rhs);
             cg_store_var(fn, sym, r);
-            cg_free_reg(fn->cg, r);
             break;
         }
         case NODE_IF:
@@ -477,198 +737,226 @@ static void cg_generate_statement(FunctionContext *fn, AST *stmt) {
             cg_generate_while(fn, stmt);
             break;
         case NODE_READ: {
-            AST *id = stmt->child;
-            Symbol *sym = cg_lookup(fn, id ? id->name : NULL);
-            int r = cg_alloc_reg_with_tracking(fn->cg, fn);
-            cg_emit(fn->cg, "    call _read    ; read input\n");
-            cg_emit(fn->cg, "    mov %s, EAX\n", reg_name(r));
+            AST *id = ast_child(stmt);
+            Symbol *sym = cg_lookup(fn, id);
+            X86Operand r = x86_new_vreg(&fn->code);
+            cg_comment(cg_op(fn, X86_CALL, x86_label("_read"), x86_none()), "read input");
+            cg_op(fn, X86_MOV, r, x86_reg(X86_EAX));
+            /* a float variable is converted on the store */
             cg_store_var(fn, sym, r);
-            cg_free_reg(fn->cg, r);
             break;
         }
         case NODE_WRITE: {
-            int r = cg_generate_expr(fn, stmt->child);
-            cg_emit(fn->cg, "    push %s\n", reg_name(r));
-            cg_emit(fn->cg, "    call _write    ; write output\n");
-            cg_emit(fn->cg, "    add ESP, 4\n");
-            cg_free_reg(fn->cg, r);
+            X86Operand r = cg_generate_expr(fn, ast_child(stmt));
+            if (x86_is_xmm(r)) {
+                cg_push_float(fn, r);
+                cg_comment(cg_op(fn, X86_CALL, x86_label("_writef"), x86_none()), "write float output");
+                cg_op(fn, X86_ADD, x86_reg(X86_ESP), x86_imm(8));
+                break;
+            }
+            cg_op(fn, X86_PUSH, r, x86_none());
+            cg_comment(cg_op(fn, X86_CALL, x86_label("_write"), x86_none()), "write output");
+            cg_op(fn, X86_ADD, x86_reg(X86_ESP), x86_imm(4));
             break;
         }
         case NODE_RETURN: {
-            int r = cg_generate_expr(fn, stmt->child);
-            if (r != 0) {
-                cg_emit(fn->cg, "    mov EAX, %s\n", reg_name(r));
+            X86Operand r = cg_generate_expr(fn, ast_child(stmt));
+            if (fn->returnType == TYPE_FLOAT) {
+                /* doubles are returned in ST(0) */
+                cg_push_float(fn, cg_to_float(fn, r));
+                cg_comment(cg_op(fn, X86_FLD, x86_mem_qword(X86_ESP, 0), x86_none()), "return value in ST(0)");
+                cg_op(fn, X86_ADD, x86_reg(X86_ESP), x86_imm(8));
+            } else {
+                cg_op(fn, X86_MOV, x86_reg(X86_EAX), r);
             }
-            cg_free_reg(fn->cg, r);
-            cg_emit(fn->cg, "    jmp %s\n", fn->endLabel);
+            cg_jump(fn, X86_JMP, X86_CC_E, fn->endLabel);
             break;
         }
-        case NODE_FUNCTION_CALL: {
-            int r = cg_generate_function_call(fn, stmt);
-            cg_free_reg(fn->cg, r);
+        case NODE_FUNCTION_CALL:
+            cg_generate_function_call(fn, stmt);
             break;
-        }
         default:
-            if (stmt->child)
-                cg_generate_block(fn, stmt->child);
+            if (ast_child(stmt))
+                cg_generate_block(fn, ast_child(stmt));
             break;
     }
 }
 
-static void cg_generate_function(FunctionContext *fn, AST *funcNode, SymTable *scope) {
-    if (!funcNode || !scope) return;
-    fn->scope = scope;
-    /* initialize callee-saved tracking */
-    fn->callee_saved_used[0] = 0;  /* EBX */
-    fn->callee_saved_used[1] = 0;  /* ESI */
-    fn->callee_saved_used[2] = 0;  /* EDI */
-    
-    snprintf(fn->funcName, sizeof(fn->funcName), "%s", funcNode->name ? funcNode->name : "anon");
-    /* ensure endLabel fits: "_" + funcName (max 58 chars) + "_END" + null = 64 bytes total */
-    /* format "_%s_END" needs: 1 + funcName + 4 + 1 = 64, so funcName max is 58 */
-    /* use format specifier with length limit to avoid truncation warning */
-    snprintf(fn->endLabel, sizeof(fn->endLabel), "_%.58s_END", fn->funcName);
-    
-    /* find function symbol for parameter lookup */
-    fn->funcSym = symtable_lookup(scope, fn->funcName);
-    if (!fn->funcSym) {
-        /* try global scope */
-        SymTable *global = scope;
-        while (global->parent) global = global->parent;
-        fn->funcSym = symtable_lookup(global, fn->funcName);
-    }
-
-    CodeGenContext *cg = fn->cg;
-    cg_emit(cg, "_%s:\n", fn->funcName);
-    /* x86 function prologue */
-    cg_emit(cg, "    push EBP\n");
-    cg_emit(cg, "    mov EBP, ESP\n");
-    /* save only callee-saved registers that are actually used */
-    /* tracked via callee_saved_used array: EBX(0), ESI(1), EDI(2) */
-    if (fn->callee_saved_used[2]) {
-        cg_emit(cg, "    push EDI    ; save callee-saved register\n");
-    }
-    if (fn->callee_saved_used[1]) {
-        cg_emit(cg, "    push ESI    ; save callee-saved register\n");
-    }
-    if (fn->callee_saved_used[0]) {
-        cg_emit(cg, "    push EBX    ; save callee-saved register\n");
-    }
-    if (scope->frame_size > 0)
-        cg_emit(cg, "    sub ESP, %d    ; reserve space for locals\n", scope->frame_size);
-
-    AST *body = funcNode->extra;
-    if (body)
-        cg_generate_block(fn, body->child);
+/* callee-saved registers, in the order the prologue pushes them */
+static const int CALLEE_SAVED[] = { X86_EDI, X86_ESI, X86_EBX };
 
-    cg_emit(cg, "%s:\n", fn->endLabel);
-    /* restore callee-saved registers in reverse order (only those we saved) */
-    if (fn->callee_saved_used[0]) {
-        cg_emit(cg, "    pop EBX    ; restore callee-saved register\n");
+/* frame-relative bytes the function's locals occupy; parameters live above EBP */
+static int cg_locals_size(const SymTable *scope) {
+    int size = 0;
+    for (const Symbol *s = scope->symbols; s; s = s->next) {
+        if (s->kind == SYM_VAR && s->offset > size) size = s->offset;
     }
-    if (fn->callee_saved_used[1]) {
-        cg_emit(cg, "    pop ESI    ; restore callee-saved register\n");
+    return size;
+}
+
+/* wraps the allocated body in fn->code with the prologue and epilogue */
+static void cg_frame_function(FunctionContext *fn, int frameSize, int spillBytes, unsigned int usedRegs) {
+    X86Code body = fn->code;
+    x86_code_init(&fn->code);
+    /* a return at the very end falls through to the epilogue */
+    if (body.count > 0 && body.insns[body.count - 1].op == X86_JMP &&
+        body.insns[body.count - 1].dst.name == fn->endLabel)
+        body.count--;
+
+    cg_place_label(fn, cg_text(fn, "_%s", fn->funcName));
+    cg_op(fn, X86_PUSH, x86_reg(X86_EBP), x86_none());
+    cg_op(fn, X86_MOV, x86_reg(X86_EBP), x86_reg(X86_ESP));
+    if (frameSize > 0)
+        cg_comment(cg_op(fn, X86_SUB, x86_reg(X86_ESP), x86_imm(frameSize)),
+                   spillBytes > 0 ? "reserve space for locals and spill slots" : "reserve space for locals");
+    /* save only callee-saved registers the allocator handed out; they go below
+       the frame so EBP-relative locals and spill slots are not disturbed */
+    for (int i = 0; i < 3; i++) {
+        if (usedRegs & (1u << CALLEE_SAVED[i]))
+            cg_comment(cg_op(fn, X86_PUSH, x86_reg(CALLEE_SAVED[i]), x86_none()), "save callee-saved register");
     }
-    if (fn->callee_saved_used[2]) {
-        cg_emit(cg, "    pop EDI    ; restore callee-saved register\n");
+    if (x86_code_append(&fn->code, &body) != 0) fn->cg->failed = 1;
+    x86_code_free(&body);
+
+    cg_place_label(fn, fn->endLabel);
+    /* restore callee-saved registers in reverse order (only those we saved) */
+    for (int i = 2; i >= 0; i--) {
+        if (usedRegs & (1u << CALLEE_SAVED[i]))
+            cg_comment(cg_op(fn, X86_POP, x86_reg(CALLEE_SAVED[i]), x86_none()), "restore callee-saved register");
     }
     /* x86 function epilogue */
-    cg_emit(cg, "    mov ESP, EBP\n");
-    cg_emit(cg, "    pop EBP\n");
-    cg_emit(cg, "    ret\n\n");
-}
-
-/* collect string literals from AST for .data section */
-static void collect_string_literals(AST *node, char **strings, int *count, int max_count) {
-    if (!node) return;
-    if (node->kind == NODE_STRING_LITERAL && node->name) {
-        /* check if already collected */
-        int found = 0;
-        for (int i = 0; i < *count; i++) {
-            if (strings[i] && strcmp(strings[i], node->name) == 0) {
-                found = 1;
-                break;
-            }
-        }
-        if (!found && *count < max_count) {
-            strings[*count] = node->name;
-            (*count)++;
-        }
+    cg_op(fn, X86_MOV, x86_reg(X86_ESP), x86_reg(X86_EBP));
+    cg_op(fn, X86_POP, x86_reg(X86_EBP), x86_none());
+    cg_op(fn, X86_RET, x86_none(), x86_none());
+}
+
+static void cg_generate_function(FunctionContext *fn, AST *funcNode, SymTable *scope) {
+    if (!funcNode || !scope) return;
+    fn->scope = scope;
+    fn->returnType = funcNode->typeId;
+    x86_code_init(&fn->code);
+
+    snprintf(fn->funcName, sizeof(fn->funcName), "%s", ast_name(funcNode) ? ast_name(funcNode) : "anon");
+    /* funcName is at most 63 chars, so the label fits the text buffer */
+    fn->endLabel = cg_text(fn, "_%s_END", fn->funcName);
+
+    AST *body = ast_extra(funcNode);
+    if (body)
+        cg_generate_block(fn, ast_child(body));
+
+    /* the body is complete, so the frame and the saved registers are known */
+    int localsSize = cg_locals_size(scope);
+    unsigned int usedRegs = 0;
+    int spillBytes = -1;
+    if (!fn->cg->failed && peephole_run(&fn->code) >= 0) {
+        spillBytes = regalloc_run(&fn->code, localsSize, &usedRegs);
+        /* allocation can leave copies between the same registers and spill slots */
+        if (spillBytes >= 0 && peephole_run(&fn->code) < 0) spillBytes = -1;
+    }
+    if (spillBytes < 0) {
+        fn->cg->failed = 1;
+    } else {
+        cg_frame_function(fn, localsSize + spillBytes, spillBytes, usedRegs);
+        x86_code_print(&fn->code, fn->cg->out);
+        cg_emit(fn->cg, "\n");
     }
-    /* recursively collect from children and siblings */
-    if (node->child) collect_string_literals(node->child, strings, count, max_count);
-    if (node->sibling) collect_string_literals(node->sibling, strings, count, max_count);
-    if (node->extra) collect_string_literals(node->extra, strings, count, max_count);
+    x86_code_free(&fn->code);
+}
+
+static unsigned int pool_hash(unsigned long long key) {
+    return (unsigned int)(key ^ (key >> 32)) * 2654435761u;
 }
 
-/* collect float literals from AST for .data section */
-static void collect_float_literals(AST *node) {
-    if (!node) return;
-    if (node->kind == NODE_FLOAT_LITERAL) {
-        get_float_index(node->floatValue);
+/* doubles are pooled by bit pattern, so 0.0 and -0.0 keep separate labels */
+static unsigned long long float_key(double value) {
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/* the entry's label number, or -1 if the key is not pooled */
+static int pool_find(const ConstPool *pool, unsigned long long key) {
+    if (pool->slotCapacity == 0) return -1;
+    unsigned int mask = (unsigned int)pool->slotCapacity - 1;
+    for (unsigned int pos = pool_hash(key) & mask; pool->slots[pos]; pos = (pos + 1) & mask) {
+        if (pool->entries[pool->slots[pos] - 1].key == key) return pool->slots[pos] - 1;
     }
-    /* recursively collect from children and siblings */
-    if (node->child) collect_float_literals(node->child);
-    if (node->sibling) collect_float_literals(node->sibling);
-    if (node->extra) collect_float_literals(node->extra);
+    return -1;
 }
 
-static void generate_data_section(CodeGenContext *cg, AST *root) {
-    char *strings[100];  /* max 100 unique string literals */
-    int count = 0;
-    string_map_count = 0;  /* reset mapping */
-    float_map_count = 0;   /* reset float mapping */
-    
-    collect_string_literals(root, strings, &count, 100);
-    collect_float_literals(root);  /* collect float literals */
-    
-    /* build string-to-index mapping */
-    for (int i = 0; i < count; i++) {
-        string_map[string_map_count].str = strings[i];
-        string_map[string_map_count].index = i;
-        string_map_count++;
+static void pool_index(ConstPool *pool, int entry) {
+    unsigned int mask = (unsigned int)pool->slotCapacity - 1;
+    unsigned int pos = pool_hash(pool->entries[entry].key) & mask;
+    while (pool->slots[pos]) pos = (pos + 1) & mask;
+    pool->slots[pos] = entry + 1;
+}
+
+/* adds the literal unless its key is already pooled; -1 if out of memory */
+static int pool_add(ConstPool *pool, unsigned long long key, const AST *literal) {
+    if (pool_find(pool, key) >= 0) return 0;
+    if (pool->count == pool->capacity) {
+        int capacity = pool->capacity ? pool->capacity * 2 : 16;
+        PoolEntry *grown = (PoolEntry*)realloc(pool->entries, (size_t)capacity * sizeof(PoolEntry));
+        if (!grown) return -1;
+        pool->entries = grown;
+        pool->capacity = capacity;
     }
-    
-    if (count > 0 || float_map_count > 0) {
-        cg_emit(cg, "    .data\n");
-        /* generate string literals */
-        for (int i = 0; i < count; i++) {
-            /* generate label from index */
-            char label[128];
-            snprintf(label, sizeof(label), "str_%d", i);
-            cg_emit(cg, "%s DB \"%s\", 0\n", label, strings[i]);
-        }
-        /* generate float literals */
-        for (int i = 0; i < float_map_count; i++) {
-            cg_emit(cg, "float_%d DQ %f    ; float constant\n", i, float_map[i].value);
-        }
-        cg_emit(cg, "\n");
+    if ((pool->count + 1) * 2 > pool->slotCapacity) {
+        int slotCapacity = pool->slotCapacity ? pool->slotCapacity * 2 : 32;
+        int *slots = (int*)calloc((size_t)slotCapacity, sizeof(int));
+        if (!slots) return -1;
+        free(pool->slots);
+        pool->slots = slots;
+        pool->slotCapacity = slotCapacity;
+        for (int i = 0; i < pool->count; i++) pool_index(pool, i);
     }
+    pool->entries[pool->count].key = key;
+    pool->entries[pool->count].literal = literal;
+    pool_index(pool, pool->count++);
+    return 0;
+}
+
+static void pool_free(ConstPool *pool) {
+    free(pool->entries);
+    free(pool->slots);
+    memset(pool, 0, sizeof(*pool));
 }
 
-static int get_string_index(const char *str) {
-    for (int i = 0; i < string_map_count; i++) {
-        if (string_map[i].str && strcmp(string_map[i].str, str) == 0) {
-            return string_map[i].index;
+/* one walk over the AST pools every string and float literal; siblings are
+   followed in a loop so long statement lists do not deepen the recursion */
+static int collect_literals(CodeGenContext *cg, const AST *node) {
+    for (; node; node = ast_sibling(node)) {
+        if (node->kind == NODE_STRING_LITERAL && node->nameId) {
+            if (pool_add(&cg->strings, node->nameId, node) != 0) return -1;
+        } else if (node->kind == NODE_FLOAT_LITERAL) {
+            if (pool_add(&cg->floats, float_key(node->floatValue), node) != 0) return -1;
+        } else if (node->kind == NODE_UNARY_OP && node->op == OP_NEG && is_float_expr(ast_child(node))) {
+            /* -0.0 is the sign bit alone: the xorpd mask for negation */
+            if (pool_add(&cg->floats, float_key(-0.0), NULL) != 0) return -1;
         }
+        if (collect_literals(cg, ast_child(node)) != 0) return -1;
+        if (collect_literals(cg, ast_extra(node)) != 0) return -1;
     }
-    return -1;  /* not found */
+    return 0;
 }
 
-static int get_float_index(double value) {
-    /* check if float value already exists in mapping */
-    for (int i = 0; i < float_map_count; i++) {
-        if (float_map[i].value == value) {
-            return float_map[i].index;
-        }
+static void generate_data_section(CodeGenContext *cg, AST *root) {
+    if (collect_literals(cg, root) != 0) {
+        cg->failed = 1;
+        return;
     }
-    /* add new float to mapping */
-    if (float_map_count < 100) {
-        float_map[float_map_count].value = value;
-        float_map[float_map_count].index = float_map_count;
-        return float_map_count++;
+    if (cg->strings.count == 0 && cg->floats.count == 0) return;
+
+    cg_emit(cg, "    .data\n");
+    for (int i = 0; i < cg->strings.count; i++)
+        cg_emit(cg, "str_%d DB \"%s\", 0\n", i, ast_name(cg->strings.entries[i].literal));
+    for (int i = 0; i < cg->floats.count; i++) {
+        const PoolEntry *entry = &cg->floats.entries[i];
+        double value;
+        memcpy(&value, &entry->key, sizeof(value));
+        cg_emit(cg, "float_%d DQ %.17e    ; %s\n", i, value, entry->literal ? "float constant" : "sign mask");
     }
-    return -1;  /* mapping full */
+    cg_emit(cg, "\n");
 }
 
 int codegen_generate(AST *root, SymTable *global, const char *outPath) {
@@ -681,7 +969,8 @@ int codegen_generate(AST *root, SymTable *global, const char *outPath) {
     cg_emit(&cg, "; Auto-generated x86-32 assembly code\n");
     cg_emit(&cg, "; Target: x86 (32-bit) architecture\n");
     cg_emit(&cg, "; Calling convention: cdecl (caller cleans stack)\n\n");
-    cg_emit(&cg, "    .386\n");
+    cg_emit(&cg, "    .686\n");
+    cg_emit(&cg, "    .xmm\n");
     cg_emit(&cg, "    .model flat, c\n");
     
     /* generate .data section for string literals */
@@ -693,18 +982,23 @@ int codegen_generate(AST *root, SymTable *global, const char *outPath) {
     fn.cg = &cg;
     fn.scope = global;
 
-    for (AST *p = root->child; p; p = p->sibling) {
+    for (AST *p = ast_child(root); p; p = ast_sibling(p)) {
         if (p->kind == NODE_FUNC_DECL) {
-            SymTable *fnScope = symtable_find_scope(global, p->name, global);
+            /* scope attached by semantic pass A; look it up for ASTs that skipped it */
+            SymTable *fnScope = p->scope;
             if (!fnScope)
-                fnScope = symtable_find_scope(global, p->name, NULL);
+                fnScope = symtable_find_scope(global, p->nameId, global);
+            if (!fnScope)
+                fnScope = symtable_find_scope(global, p->nameId, NULL);
             cg_generate_function(&fn, p, fnScope ? fnScope : global);
         }
     }
 
     cg_emit(&cg, "    end\n");
     fclose(out);
-    return 0;
+    pool_free(&cg.strings);
+    pool_free(&cg.floats);
+    return cg.failed;
 }
 
 /* intermediate representation (3AC) generation */
@@ -721,6 +1015,13 @@ static void ir_emit_3ac(FILE *out, const char *op, const char *arg1, const char
     }
 }
 
+/* 3AC spelling of each OpCode; OP_NONE prints as "+" like a nameless node did */
+static const char *const IR_OPS[OP_COUNT] = {
+    "+", "+", "-", "*", "/", "and", "or",
+    "==", "<>", "<", ">", "<=", ">=", "[]",
+    "not", "-", "+"
+};
+
 static char *ir_make_temp(CodeGenContext *cg) {
     char *temp = (char *)malloc(16);
     snprintf(temp, 16, "t%d", cg->tempCounter++);
@@ -739,12 +1040,12 @@ static char *ir_generate_expr_3ac(FILE *out, CodeGenContext *cg, FunctionContext
     switch (expr->kind) {
         case NODE_ID: {
             char *temp = ir_make_temp(cg);
-            Symbol *sym = cg_lookup(fn, expr->name);
+            Symbol *sym = cg_lookup(fn, expr);
             if (sym) {
                 if (sym->kind == SYM_PARAM) {
-                    fprintf(out, "    %s = param %s\n", temp, expr->name);
+                    fprintf(out, "    %s = param %s\n", temp, ast_name(expr));
                 } else {
-                    fprintf(out, "    %s = load %s\n", temp, expr->name);
+                    fprintf(out, "    %s = load %s\n", temp, ast_name(expr));
                 }
             } else {
                 fprintf(out, "    %s = 0    ; undefined\n", temp);
@@ -762,28 +1063,26 @@ static char *ir_generate_expr_3ac(FILE *out, CodeGenContext *cg, FunctionContext
             return temp;
         }
         case NODE_BINARY_OP: {
-            char *left = ir_generate_expr_3ac(out, cg, fn, expr->child);
-            char *right = ir_generate_expr_3ac(out, cg, fn, expr->child ? expr->child->sibling : NULL);
+            char *left = ir_generate_expr_3ac(out, cg, fn, ast_child(expr));
+            char *right = ir_generate_expr_3ac(out, cg, fn, ast_child(expr) ? ast_sibling(ast_child(expr)) : NULL);
             char *result = ir_make_temp(cg);
-            const char *op = expr->name ? expr->name : "+";
-            fprintf(out, "    %s = %s %s, %s\n", result, left, op, right);
+            fprintf(out, "    %s = %s %s, %s\n", result, left, IR_OPS[expr->op], right);
             free(left);
             free(right);
             return result;
         }
         case NODE_UNARY_OP: {
-            char *inner = ir_generate_expr_3ac(out, cg, fn, expr->child);
+            char *inner = ir_generate_expr_3ac(out, cg, fn, ast_child(expr));
             char *result = ir_make_temp(cg);
-            const char *op = expr->name ? expr->name : "not";
-            fprintf(out, "    %s = %s %s\n", result, op, inner);
+            fprintf(out, "    %s = %s %s\n", result, expr->op ? IR_OPS[expr->op] : "not", inner);
             free(inner);
             return result;
         }
         case NODE_FUNCTION_CALL: {
             char *result = ir_make_temp(cg);
-            fprintf(out, "    %s = call %s(", result, expr->name ? expr->name : "anon");
+            fprintf(out, "    %s = call %s(", result, ast_name(expr) ? ast_name(expr) : "anon");
             int first = 1;
-            for (AST *arg = expr->child; arg; arg = arg->sibling) {
+            for (AST *arg = ast_child(expr); arg; arg = ast_sibling(arg)) {
                 if (!first) fprintf(out, ", ");
                 char *argTemp = ir_generate_expr_3ac(out, cg, fn, arg);
                 fprintf(out, "%s", argTemp);
@@ -801,6 +1100,59 @@ static char *ir_generate_expr_3ac(FILE *out, CodeGenContext *cg, FunctionContext
     }
 }
 
+static void ir_generate_store_3ac(FILE *out, CodeGenContext *cg, FunctionContext *fn, AST *assign) {
+    AST *lhs = ast_child(assign);
+    char *rhs = ir_generate_expr_3ac(out, cg, fn, lhs ? ast_sibling(lhs) : NULL);
+    fprintf(out, "    store %s, %s\n", lhs ? ast_name(lhs) : "?", rhs);
+    free(rhs);
+}
+
+/* the assignments of a then, else or loop body, including nested blocks */
+static void ir_generate_block_3ac(FILE *out, CodeGenContext *cg, FunctionContext *fn, AST *block) {
+    for (AST *s = ast_child(block); s; s = ast_sibling(s)) {
+        if (s->kind == NODE_ASSIGN)
+            ir_generate_store_3ac(out, cg, fn, s);
+        else if (s->kind == NODE_STATEMENT_LIST)
+            ir_generate_block_3ac(out, cg, fn, s);
+    }
+}
+
+/* a constant-condition IF pruned by constfold is left as a STATEMENT_LIST */
+static void ir_generate_statement_3ac(FILE *out, CodeGenContext *cg, FunctionContext *fn, AST *stmt) {
+    if (stmt->kind == NODE_ASSIGN) {
+        ir_generate_store_3ac(out, cg, fn, stmt);
+    } else if (stmt->kind == NODE_STATEMENT_LIST) {
+        for (AST *s = ast_child(stmt); s; s = ast_sibling(s))
+            ir_generate_statement_3ac(out, cg, fn, s);
+    } else if (stmt->kind == NODE_RETURN) {
+        char *ret = ir_generate_expr_3ac(out, cg, fn, ast_child(stmt));
+        fprintf(out, "    return %s\n", ret);
+        free(ret);
+    } else if (stmt->kind == NODE_IF) {
+        char *cond = ir_generate_expr_3ac(out, cg, fn, ast_child(stmt));
+        fprintf(out, "    if %s goto L_then else goto L_else\n", cond);
+        free(cond);
+        fprintf(out, "  L_then:\n");
+        AST *thenBlock = ast_child(stmt) ? ast_sibling(ast_child(stmt)) : NULL;
+        if (thenBlock) ir_generate_block_3ac(out, cg, fn, thenBlock);
+        fprintf(out, "    goto L_if_end\n");
+        fprintf(out, "  L_else:\n");
+        AST *elseBlock = thenBlock ? ast_sibling(thenBlock) : NULL;
+        if (elseBlock) ir_generate_block_3ac(out, cg, fn, elseBlock);
+        fprintf(out, "  L_if_end:\n");
+    } else if (stmt->kind == NODE_WHILE) {
+        fprintf(out, "  L_while_top:\n");
+        char *cond = ir_generate_expr_3ac(out, cg, fn, ast_child(stmt));
+        fprintf(out, "    if %s goto L_while_body else goto L_while_end\n", cond);
+        free(cond);
+        fprintf(out, "  L_while_body:\n");
+        AST *bodyBlock = ast_child(stmt) ? ast_sibling(ast_child(stmt)) : NULL;
+        if (bodyBlock) ir_generate_block_3ac(out, cg, fn, bodyBlock);
+        fprintf(out, "    goto L_while_top\n");
+        fprintf(out, "  L_while_end:\n");
+    }
+}
+
 int codegen_generate_ir(AST *root, SymTable *global, const char *outPath) {
     if (!root || !outPath) return 1;
     FILE *out = fopen(outPath, "w");
@@ -817,81 +1169,24 @@ int codegen_generate_ir(AST *root, SymTable *global, const char *outPath) {
     fn.cg = &cg;
     fn.scope = global;
 
-    for (AST *p = root->child; p; p = p->sibling) {
+    for (AST *p = ast_child(root); p; p = ast_sibling(p)) {
         if (p->kind == NODE_FUNC_DECL) {
-            fprintf(out, "function %s:\n", p->name ? p->name : "anon");
+            fprintf(out, "function %s:\n", ast_name(p) ? ast_name(p) : "anon");
             
-            SymTable *fnScope = symtable_find_scope(global, p->name, global);
+            /* scope attached by semantic pass A; look it up for ASTs that skipped it */
+            SymTable *fnScope = p->scope;
+            if (!fnScope)
+                fnScope = symtable_find_scope(global, p->nameId, global);
             if (!fnScope)
-                fnScope = symtable_find_scope(global, p->name, NULL);
+                fnScope = symtable_find_scope(global, p->nameId, NULL);
             fn.scope = fnScope ? fnScope : global;
-            fn.funcSym = symtable_lookup(fn.scope, p->name);
             
             fprintf(out, "  prologue\n");
             
-            AST *body = p->extra;
+            AST *body = ast_extra(p);
             if (body) {
-                for (AST *stmt = body->child; stmt; stmt = stmt->sibling) {
-                    if (stmt->kind == NODE_ASSIGN) {
-                        AST *lhs = stmt->child;
-                        char *rhs = ir_generate_expr_3ac(out, &cg, &fn, lhs ? lhs->sibling : NULL);
-                        fprintf(out, "    store %s, %s\n", lhs ? lhs->name : "?", rhs);
-                        free(rhs);
-                    } else if (stmt->kind == NODE_RETURN) {
-                        char *ret = ir_generate_expr_3ac(out, &cg, &fn, stmt->child);
-                        fprintf(out, "    return %s\n", ret);
-                        free(ret);
-                    } else if (stmt->kind == NODE_IF) {
-                        char *cond = ir_generate_expr_3ac(out, &cg, &fn, stmt->child);
-                        fprintf(out, "    if %s goto L_then else goto L_else\n", cond);
-                        free(cond);
-                        fprintf(out, "  L_then:\n");
-                        AST *thenBlock = stmt->child ? stmt->child->sibling : NULL;
-                        if (thenBlock) {
-                            for (AST *s = thenBlock->child; s; s = s->sibling) {
-                                if (s->kind == NODE_ASSIGN) {
-                                    AST *lhs = s->child;
-                                    char *rhs = ir_generate_expr_3ac(out, &cg, &fn, lhs ? lhs->sibling : NULL);
-                                    fprintf(out, "    store %s, %s\n", lhs ? lhs->name : "?", rhs);
-                                    free(rhs);
-                                }
-                            }
-                        }
-                        fprintf(out, "    goto L_if_end\n");
-                        fprintf(out, "  L_else:\n");
-                        AST *elseBlock = thenBlock ? thenBlock->sibling : NULL;
-                        if (elseBlock) {
-                            for (AST *s = elseBlock->child; s; s = s->sibling) {
-                                if (s->kind == NODE_ASSIGN) {
-                                    AST *lhs = s->child;
-                                    char *rhs = ir_generate_expr_3ac(out, &cg, &fn, lhs ? lhs->sibling : NULL);
-                                    fprintf(out, "    store %s, %s\n", lhs ? lhs->name : "?", rhs);
-                                    free(rhs);
-                                }
-                            }
-                        }
-                        fprintf(out, "  L_if_end:\n");
-                    } else if (stmt->kind == NODE_WHILE) {
-                        fprintf(out, "  L_while_top:\n");
-                        char *cond = ir_generate_expr_3ac(out, &cg, &fn, stmt->child);
-                        fprintf(out, "    if %s goto L_while_body else goto L_while_end\n", cond);
-                        free(cond);
-                        fprintf(out, "  L_while_body:\n");
-                        AST *bodyBlock = stmt->child ? stmt->child->sibling : NULL;
-                        if (bodyBlock) {
-                            for (AST *s = bodyBlock->child; s; s = s->sibling) {
-                                if (s->kind == NODE_ASSIGN) {
-                                    AST *lhs = s->child;
-                                    char *rhs = ir_generate_expr_3ac(out, &cg, &fn, lhs ? lhs->sibling : NULL);
-                                    fprintf(out, "    store %s, %s\n", lhs ? lhs->name : "?", rhs);
-                                    free(rhs);
-                                }
-                            }
-                        }
-                        fprintf(out, "    goto L_while_top\n");
-                        fprintf(out, "  L_while_end:\n");
-                    }
-                }
+                for (AST *stmt = ast_child(body); stmt; stmt = ast_sibling(stmt))
+                    ir_generate_statement_3ac(out, &cg, &fn, stmt);
             }
             fprintf(out, "  epilogue\n\n");
         }
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compiler.h"
+#include "ast.h"
+#include "symbol_table.h"
+#include "lexer_support.h"
+#include "source_buffer.h"
+#include "semantic.h"
+#include "constfold.h"
+#include "codegen.h"
+#include "parser.tab.h"
+
+#define ARTIFACT_PATH_MAX 4096
+
+void compile_options_init(CompileOptions *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->tokenMode = ARTIFACT_BUFFER;
+    opts->symbolMode = ARTIFACT_BUFFER;
+    opts->derivationMode = ARTIFACT_STREAM;
+}
+
+/* artifacts are written as <outputPrefix><name> */
+static void artifact_path(const CompileOptions *opts, const char *name, char *path, size_t size) {
+    snprintf(path, size, "%s%s", opts->outputPrefix ? opts->outputPrefix : "", name);
+}
+
+static FILE *open_artifact(const CompileOptions *opts, const char *name) {
+    char path[ARTIFACT_PATH_MAX];
+    artifact_path(opts, name, path, sizeof(path));
+    return fopen(path, "w");
+}
+
+static void close_artifacts(CompilerContext *ctx, FILE *toklog, FILE *lexsym) {
+    if (toklog) fclose(toklog);
+    if (lexsym) fclose(lexsym);
+    derivation_log_flush(&ctx->derivation);
+    if (ctx->derivation.file) fclose(ctx->derivation.file);
+    ctx->derivation.file = NULL;
+}
+
+/* releases everything the compilation allocated; the source buffer goes
+   last because the lexer logs may still hold views into it */
+static void compiler_release(CompilerContext *ctx, SourceBuffer *source) {
+    semantic_free(&ctx->sem);
+    ast_arena_destroy(ctx->astArena);
+    ctx->astArena = NULL;
+    ctx->astRoot = NULL;
+    lex_support_destroy(ctx->lex);
+    ctx->lex = NULL;
+    type_table_destroy(ctx->types);
+    ctx->types = NULL;
+    intern_pool_destroy(ctx->names);
+    ctx->names = NULL;
+    source_buffer_close(source);
+}
+
+int compiler_compile(const CompileOptions *opts) {
+    CompilerContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.scan.current_line = 1;
+    ctx.scan.current_column = 1;
+    ctx.scan.token_start_column = 1;
+    ctx.derivation.mode = opts->derivationMode;
+    SourceBuffer source = {0};
+    ctx.names = intern_pool_create();
+    ctx.types = ctx.names ? type_table_create(ctx.names) : NULL;
+    ctx.lex = ctx.names ? lex_support_create(ctx.names) : NULL;
+    ctx.astArena = ctx.names ? ast_arena_create(ctx.names) : NULL;
+    if (!ctx.types || !ctx.lex || !ctx.astArena) {
+        fprintf(stderr, "Out of memory.\n");
+        compiler_release(&ctx, &source);
+        return 1;
+    }
+
+    yyscan_t scanner;
+    if (scanner_create(&ctx, &scanner) != 0) {
+        fprintf(stderr, "Cannot create scanner.\n");
+        compiler_release(&ctx, &source);
+        return 1;
+    }
+
+    /* mmap input: flex scans the mapping directly and the lexer logs keep
+       views into it, so it stays open until the logs are written */
+    FILE *f = NULL;
+    if (opts->mapInput) {
+        if (source_buffer_open(&source, opts->sourcePath) != 0) {
+            perror("mmap");
+            scanner_destroy(scanner);
+            compiler_release(&ctx, &source);
+            return 1;
+        }
+        if (scanner_use_buffer(scanner, source.data, source.length + 2) != 0) {
+            fprintf(stderr, "Cannot scan %s in place.\n", opts->sourcePath);
+            scanner_destroy(scanner);
+            compiler_release(&ctx, &source);
+            return 1;
+        }
+        lex_support_set_source(ctx.lex, source.data, source.length);
+    } else {
+        f = fopen(opts->sourcePath, "r");
+        if (!f) {
+            perror("fopen");
+            scanner_destroy(scanner);
+            compiler_release(&ctx, &source);
+            return 1;
+        }
+        scanner_set_file(scanner, f);
+    }
+
+    /* streamed artifacts are written during the scan/parse; buffered ones at the end */
+    FILE *toklog = opts->tokenMode == ARTIFACT_STREAM ? open_artifact(opts, "lexer_tokens.txt") : NULL;
+    FILE *lexsym = opts->symbolMode == ARTIFACT_STREAM ? open_artifact(opts, "lexer_symbols.txt") : NULL;
+    lex_support_set_token_mode(ctx.lex, opts->tokenMode, toklog);
+    lex_support_set_symbol_mode(ctx.lex, opts->symbolMode, lexsym);
+    if (ctx.derivation.mode != ARTIFACT_OFF)
+        ctx.derivation.file = open_artifact(opts, "derivation_steps.txt");
+
+    int parseResult = yyparse(scanner, &ctx);
+    scanner_destroy(scanner);
+    if (f) fclose(f);
+    if (parseResult != 0) {
+        fprintf(stderr, "Parsing failed.\n");
+        close_artifacts(&ctx, toklog, lexsym);
+        compiler_release(&ctx, &source);
+        return 1;
+    }
+    derivation_log_flush(&ctx.derivation);
+    if (ctx.derivation.file) fflush(ctx.derivation.file);
+
+    if (!ctx.astRoot) {
+        fprintf(stderr, "No AST produced.\n");
+        close_artifacts(&ctx, toklog, lexsym);
+        compiler_release(&ctx, &source);
+        return 1;
+    }
+
+    if (!opts->quiet) {
+        printf("=== AST ===\n");
+        ast_print(ctx.astRoot, 0);
+    }
+
+    /* open semantic error file */
+    FILE *errFile = open_artifact(opts, "semantic_errors.txt");
+    if (!errFile) errFile = stdout;
+    semantic_init(&ctx.sem, ctx.names, ctx.types, errFile);
+
+    /* pass A: build symbol tables */
+    semantic_passA(&ctx.sem, ctx.astRoot);
+
+    /* write symbol table */
+    FILE *symout = open_artifact(opts, "symbol_table.txt");
+    if (symout) {
+        symtable_print_all(ctx.sem.globalTable, symout);
+        fclose(symout);
+    }
+
+    /* pass B: semantic checks */
+    semantic_passB(&ctx.sem, ctx.astRoot);
+    int semanticErrors = semantic_error_total(&ctx.sem);
+
+    /* lexical artifacts */
+    if (opts->symbolMode == ARTIFACT_BUFFER && (lexsym = open_artifact(opts, "lexer_symbols.txt")))
+        lex_support_dump_symbols(ctx.lex, lexsym);
+    if (opts->tokenMode == ARTIFACT_BUFFER && (toklog = open_artifact(opts, "lexer_tokens.txt")))
+        lex_support_dump_tokens(ctx.lex, toklog);
+    FILE *lexerr = open_artifact(opts, "lexer_errors.txt");
+    if (lexerr) {
+        lex_support_dump_errors(ctx.lex, lexerr);
+        fclose(lexerr);
+    }
+
+    int status = semanticErrors == 0 ? 0 : COMPILE_SEMANTIC_ERRORS;
+    if (semanticErrors == 0) {
+        /* every expression is typed now, so constants can be evaluated */
+        constfold_run(ctx.astRoot);
+
+        char irPath[ARTIFACT_PATH_MAX], asmPath[ARTIFACT_PATH_MAX];
+        char relocPath[ARTIFACT_PATH_MAX], absPath[ARTIFACT_PATH_MAX];
+        artifact_path(opts, "codegen.ir", irPath, sizeof(irPath));
+        artifact_path(opts, "codegen.asm", asmPath, sizeof(asmPath));
+        artifact_path(opts, "codegen.reloc", relocPath, sizeof(relocPath));
+        artifact_path(opts, "codegen.abs", absPath, sizeof(absPath));
+
+        /* generate Intermediate Representation */
+        if (codegen_generate_ir(ctx.astRoot, ctx.sem.globalTable, irPath) == 0) {
+            if (!opts->quiet) printf("Intermediate Representation written to %s\n", irPath);
+        }
+
+        /* generate Assembly Code */
+        if (codegen_generate(ctx.astRoot, ctx.sem.globalTable, asmPath) == 0) {
+            if (!opts->quiet) printf("Assembly code written to %s\n", asmPath);
+
+            /* generate Relocatable Machine Code */
+            if (codegen_generate_relocatable(asmPath, relocPath) == 0) {
+                if (!opts->quiet) printf("Relocatable machine code written to %s\n", relocPath);
+            }
+
+            /* generate Absolute Machine Code */
+            if (codegen_generate_absolute(asmPath, absPath) == 0) {
+                if (!opts->quiet) printf("Absolute machine code written to %s\n", absPath);
+            }
+        } else {
+            fprintf(stderr, "Code generation failed.\n");
+            status = COMPILE_CODEGEN_FAILED;
+        }
+    } else if (!opts->quiet) {
+        printf("Skipping code generation due to %d semantic error(s).\n", semanticErrors);
+    }
+
+    if (errFile != stdout) fclose(errFile);
+    close_artifacts(&ctx, toklog, lexsym);
+    compiler_release(&ctx, &source);
+
+    if (opts->quiet) return status;
+    printf("Done. See ");
+    if (toklog) printf("lexer_tokens.txt, ");
+    if (lexsym) printf("lexer_symbols.txt, ");
+    printf("semantic_errors.txt, symbol_table.txt");
+    if (semanticErrors == 0) {
+        printf(", codegen.ir, codegen.asm, codegen.reloc, codegen.abs");
+    }
+    printf("\n");
+    return status;
+}
@@ -0,0 +1,77 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "ast.h"
+#include "lexer_support.h"
+#include "semantic.h"
+
+/* what to compile and which artifacts to produce */
+typedef struct CompileOptions {
+    const char *sourcePath;
+    const char *outputPrefix;      /* prepended to every artifact name; NULL for the cwd */
+    int quiet;                     /* no AST dump or progress messages on stdout */
+    int mapInput;                  /* scan a memory mapping instead of a FILE* */
+    ArtifactMode tokenMode;
+    ArtifactMode symbolMode;
+    ArtifactMode derivationMode;
+} CompileOptions;
+
+/* scanner position, advanced by the lexer actions */
+typedef struct ScanPosition {
+    int current_line;
+    int current_column;
+    int token_start_column;
+    int comment_start_line;
+    int comment_start_column;
+} ScanPosition;
+
+/* parser derivation log (derivation_steps.txt) */
+typedef struct DerivationLog {
+    FILE *file;
+    ArtifactMode mode;
+    char *buffer;                  /* ARTIFACT_BUFFER only */
+    size_t length;
+    size_t capacity;
+} DerivationLog;
+
+/* everything one compilation owns; the scanner gets it as yyextra and
+   the parser as its ctx parameter, so nothing is shared between runs */
+struct CompilerContext {
+    InternPool *names;             /* every identifier, type name and operator */
+    TypeTable *types;              /* builtin and class type descriptors */
+    ScanPosition scan;
+    LexSupport *lex;
+    DerivationLog derivation;
+    AstArena *astArena;            /* AST nodes */
+    AST *astRoot;
+    SemanticContext sem;
+};
+typedef struct CompilerContext CompilerContext;
+
+/* compiler_compile results when the source parsed but no code was written;
+   every other failure is 1 */
+#define COMPILE_SEMANTIC_ERRORS 2
+#define COMPILE_CODEGEN_FAILED  3
+
+void compile_options_init(CompileOptions *opts);
+/* runs the whole pipeline; returns 0 once every artifact is written */
+int compiler_compile(const CompileOptions *opts);
+
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+
+/* reentrant scanner helpers (scanner.l) */
+int scanner_create(struct CompilerContext *ctx, yyscan_t *scanner);
+void scanner_set_file(yyscan_t scanner, FILE *in);
+/* scan size bytes at base in place; the last two bytes must be NUL */
+int scanner_use_buffer(yyscan_t scanner, char *base, size_t size);
+void scanner_destroy(yyscan_t scanner);
+
+/* writes out and releases a buffered derivation log (parser.y) */
+void derivation_log_flush(DerivationLog *log);
+
+#endif
@@ -0,0 +1,282 @@
+#include <stdlib.h>
+#include "constfold.h"
+#include "symbol_table.h"
+
+/* a function's local variable and what is known about it */
+typedef struct {
+    const Symbol *sym;
+    int stores;                    /* assignments and reads into it, anywhere in the body */
+    const AST *value;              /* literal it holds once its only store has run */
+} LocalConst;
+
+typedef struct {
+    LocalConst *locals;
+    int localCount;
+    int folded;
+} Folder;
+
+static LocalConst *find_local(Folder *f, const Symbol *sym) {
+    if (!sym) return NULL;
+    for (int i = 0; i < f->localCount; i++)
+        if (f->locals[i].sym == sym) return &f->locals[i];
+    return NULL;
+}
+
+static int is_literal(const AST *e) {
+    return e && (e->kind == NODE_INT_LITERAL || e->kind == NODE_FLOAT_LITERAL);
+}
+
+static double literal_double(const AST *e) {
+    return e->kind == NODE_FLOAT_LITERAL ? e->floatValue : (double)e->intValue;
+}
+
+/* turns e into a literal in place; its sibling link is kept */
+static void make_int(Folder *f, AST *e, int value) {
+    e->kind = NODE_INT_LITERAL;
+    e->intValue = value;
+    e->nameId = 0;
+    e->typeId = TYPE_INT;
+    e->childIndex = 0;
+    f->folded++;
+}
+
+static void make_float(Folder *f, AST *e, double value) {
+    e->kind = NODE_FLOAT_LITERAL;
+    e->floatValue = value;
+    e->nameId = 0;
+    e->typeId = TYPE_FLOAT;
+    e->childIndex = 0;
+    f->folded++;
+}
+
+static int literal_true(const AST *e) {
+    return e->kind == NODE_FLOAT_LITERAL ? e->floatValue != 0.0 : e->intValue != 0;
+}
+
+static int compare(OpCode op, double l, double r) {
+    switch (op) {
+        case OP_EQ: return l == r;
+        case OP_NE: return l != r;
+        case OP_LT: return l < r;
+        case OP_GT: return l > r;
+        case OP_LE: return l <= r;
+        default:    return l >= r;
+    }
+}
+
+static int compare_int(OpCode op, int l, int r) {
+    switch (op) {
+        case OP_EQ: return l == r;
+        case OP_NE: return l != r;
+        case OP_LT: return l < r;
+        case OP_GT: return l > r;
+        case OP_LE: return l <= r;
+        default:    return l >= r;
+    }
+}
+
+/* both operands are literals; leaves e alone when the result is only known
+   at run time (division by zero) */
+static void fold_binary(Folder *f, AST *e, const AST *lhs, const AST *rhs) {
+    int isFloat = lhs->kind == NODE_FLOAT_LITERAL || rhs->kind == NODE_FLOAT_LITERAL;
+    OpCode op = e->op;
+    if (isFloat) {
+        double l = literal_double(lhs), r = literal_double(rhs);
+        switch (op) {
+            case OP_ADD: make_float(f, e, l + r); break;
+            case OP_SUB: make_float(f, e, l - r); break;
+            case OP_MUL: make_float(f, e, l * r); break;
+            case OP_DIV: if (r != 0.0) make_float(f, e, l / r); break;
+            case OP_EQ: case OP_NE: case OP_LT: case OP_GT: case OP_LE: case OP_GE:
+                make_int(f, e, compare(op, l, r));
+                break;
+            default: break;
+        }
+        return;
+    }
+    /* 32-bit wrap-around, as the machine does it */
+    int l = lhs->intValue, r = rhs->intValue;
+    unsigned int ul = (unsigned int)l, ur = (unsigned int)r;
+    switch (op) {
+        case OP_ADD: make_int(f, e, (int)(ul + ur)); break;
+        case OP_SUB: make_int(f, e, (int)(ul - ur)); break;
+        case OP_MUL: make_int(f, e, (int)(ul * ur)); break;
+        case OP_DIV:
+            /* x / -1 is lowered to neg, which wraps INT_MIN to itself */
+            if (r == -1) make_int(f, e, (int)(0u - ul));
+            else if (r != 0) make_int(f, e, l / r);
+            break;
+        case OP_AND: make_int(f, e, l == 0 ? 0 : r != 0); break;
+        case OP_OR:  make_int(f, e, l != 0 ? l : r != 0); break;
+        case OP_EQ: case OP_NE: case OP_LT: case OP_GT: case OP_LE: case OP_GE:
+            make_int(f, e, compare_int(op, l, r));
+            break;
+        default: break;
+    }
+}
+
+static void fold_expr(Folder *f, AST *e) {
+    if (!e) return;
+    switch (e->kind) {
+        case NODE_ID: {
+            LocalConst *local = find_local(f, e->symbol);
+            if (!local || !local->value) return;
+            if (e->typeId == TYPE_FLOAT) make_float(f, e, literal_double(local->value));
+            else if (local->value->kind == NODE_INT_LITERAL) make_int(f, e, local->value->intValue);
+            return;
+        }
+        case NODE_BINARY_OP: {
+            AST *lhs = ast_child(e);
+            AST *rhs = lhs ? ast_sibling(lhs) : NULL;
+            fold_expr(f, lhs);
+            fold_expr(f, rhs);
+            if (!is_literal(lhs)) return;
+            if (is_literal(rhs)) {
+                fold_binary(f, e, lhs, rhs);
+            } else if (lhs->kind == NODE_INT_LITERAL) {
+                /* a deciding left operand: the right one would never run */
+                if (e->op == OP_AND && lhs->intValue == 0) make_int(f, e, 0);
+                else if (e->op == OP_OR && lhs->intValue != 0) make_int(f, e, lhs->intValue);
+            }
+            return;
+        }
+        case NODE_UNARY_OP: {
+            AST *operand = ast_child(e);
+            fold_expr(f, operand);
+            if (!is_literal(operand)) return;
+            if (operand->kind == NODE_FLOAT_LITERAL) {
+                if (e->op == OP_NEG) make_float(f, e, -operand->floatValue);
+                else if (e->op == OP_POS) make_float(f, e, operand->floatValue);
+                return;
+            }
+            unsigned int x = (unsigned int)operand->intValue;
+            /* not is bitwise, like the instruction codegen emits for it */
+            if (e->op == OP_NEG) make_int(f, e, (int)(0u - x));
+            else if (e->op == OP_NOT) make_int(f, e, (int)~x);
+            else if (e->op == OP_POS) make_int(f, e, (int)x);
+            return;
+        }
+        case NODE_FUNCTION_CALL:
+            for (AST *arg = ast_child(e); arg; arg = ast_sibling(arg))
+                fold_expr(f, arg);
+            return;
+        default:
+            return;
+    }
+}
+
+static void count_stores(Folder *f, const AST *list) {
+    for (const AST *s = list; s; s = ast_sibling(s)) {
+        if (s->kind == NODE_ASSIGN || s->kind == NODE_READ) {
+            const AST *target = ast_child(s);
+            LocalConst *local = target && target->kind == NODE_ID ? find_local(f, target->symbol) : NULL;
+            if (local) local->stores++;
+        } else if (s->kind == NODE_IF || s->kind == NODE_WHILE || s->kind == NODE_STATEMENT_LIST) {
+            count_stores(f, ast_child(s));
+        }
+    }
+}
+
+/* the statement becomes a block holding only the given branch */
+static void replace_with_block(Folder *f, AST *s, AST *branch) {
+    s->kind = NODE_STATEMENT_LIST;
+    if (!branch) {
+        s->childIndex = 0;
+    } else if (branch->kind == NODE_STATEMENT_LIST) {
+        s->childIndex = branch->childIndex;
+    } else {
+        /* a single statement; it no longer leads into the other branch */
+        branch->siblingIndex = 0;
+        ast_set_child(s, branch);
+    }
+    f->folded++;
+}
+
+static void fold_statements(Folder *f, AST *list, int topLevel);
+
+/* a top-level statement runs exactly once, before every statement after it */
+static void fold_statement(Folder *f, AST *s, int topLevel) {
+    switch (s->kind) {
+        case NODE_ASSIGN: {
+            AST *lhs = ast_child(s);
+            AST *rhs = lhs ? ast_sibling(lhs) : NULL;
+            fold_expr(f, rhs);
+            LocalConst *local = lhs ? find_local(f, lhs->symbol) : NULL;
+            if (topLevel && local && local->stores == 1 && is_literal(rhs))
+                local->value = rhs;
+            break;
+        }
+        case NODE_WRITE:
+        case NODE_RETURN:
+            fold_expr(f, ast_child(s));
+            break;
+        case NODE_FUNCTION_CALL:
+            fold_expr(f, s);
+            break;
+        case NODE_IF: {
+            AST *cond = ast_child(s);
+            AST *thenBlock = cond ? ast_sibling(cond) : NULL;
+            AST *elseBlock = thenBlock ? ast_sibling(thenBlock) : NULL;
+            fold_expr(f, cond);
+            /* then and else are siblings, so each branch is folded on its own */
+            if (thenBlock) fold_statement(f, thenBlock, 0);
+            if (elseBlock) fold_statement(f, elseBlock, 0);
+            if (is_literal(cond))
+                replace_with_block(f, s, literal_true(cond) ? thenBlock : elseBlock);
+            break;
+        }
+        case NODE_WHILE: {
+            AST *cond = ast_child(s);
+            fold_expr(f, cond);
+            fold_statements(f, cond ? ast_sibling(cond) : NULL, 0);
+            if (is_literal(cond) && !literal_true(cond))
+                replace_with_block(f, s, NULL);
+            break;
+        }
+        case NODE_STATEMENT_LIST:
+            fold_statements(f, ast_child(s), 0);
+            break;
+        default:
+            break;
+    }
+}
+
+static void fold_statements(Folder *f, AST *list, int topLevel) {
+    for (AST *s = list; s; s = ast_sibling(s))
+        fold_statement(f, s, topLevel);
+}
+
+static void fold_function(Folder *f, AST *fn) {
+    AST *body = ast_extra(fn);
+    if (!body) return;
+    /* without room to track locals, expressions are still folded */
+    f->localCount = 0;
+    f->locals = NULL;
+    const SymTable *scope = fn->scope;
+    int capacity = 0;
+    for (const Symbol *s = scope ? scope->symbols : NULL; s; s = s->next)
+        if (s->kind == SYM_VAR) capacity++;
+    if (capacity > 0 && (f->locals = (LocalConst*)malloc((size_t)capacity * sizeof(LocalConst)))) {
+        for (const Symbol *s = scope->symbols; s; s = s->next) {
+            if (s->kind != SYM_VAR) continue;
+            LocalConst *local = &f->locals[f->localCount++];
+            local->sym = s;
+            local->stores = 0;
+            local->value = NULL;
+        }
+        count_stores(f, ast_child(body));
+    }
+    fold_statements(f, ast_child(body), 1);
+    free(f->locals);
+    f->locals = NULL;
+    f->localCount = 0;
+}
+
+int constfold_run(AST *root) {
+    Folder f = { NULL, 0, 0 };
+    if (!root) return 0;
+    for (AST *p = ast_child(root); p; p = ast_sibling(p)) {
+        if (p->kind == NODE_FUNC_DECL) fold_function(&f, p);
+    }
+    return f.folded;
+}
@@ -0,0 +1,17 @@
+#ifndef CONSTFOLD_H
+#define CONSTFOLD_H
+
+#include "ast.h"
+
+/* AST-level constant folding, run after semantic pass B has typed every
+   expression and resolved every identifier. Literal-only integer and float
+   subtrees become a single literal, computed the way the generated code
+   would compute them. A local whose only store is a top-level assignment
+   of a literal is replaced by that literal in the statements after it. IF
+   statements with a constant condition keep only the branch taken, and
+   WHILE loops whose condition is constant false are dropped.
+
+   Rewrites the tree in place; returns the number of nodes folded. */
+int constfold_run(AST *root);
+
+#endif
@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+
+#define INTERN_BLOCK_SIZE 16384
+
+/* indexed by the INTERN_* constants in intern.h */
+static const char *const well_known[INTERN_WELL_KNOWN_END] = {
+    NULL, "int", "float", "void", "string", "<nil>", "<void>", "<error>",
+    "+", "-", "*", "/", "and", "or", "not",
+    "==", "<>", "<", ">", "<=", ">=", "[]",
+    "constructor", "self", "global", "public", "private"
+};
+
+/* characters are appended to fixed blocks that never move, so the pointers
+   handed out by intern_str stay valid as the pool grows */
+typedef struct InternBlock {
+    struct InternBlock *next;
+    size_t used;
+    size_t size;
+    char data[];
+} InternBlock;
+
+struct InternPool {
+    InternBlock *blocks;           /* current block first */
+    const char **strings;          /* by id; strings[0] is unused */
+    unsigned int *hashes;          /* by id */
+    unsigned int count;            /* ids handed out, plus the reserved 0 */
+    unsigned int capacity;
+    InternId *slots;               /* open addressing over ids, at most half full */
+    unsigned int slot_capacity;    /* power of two */
+};
+
+/* FNV-1a */
+static unsigned int intern_hash(const char *s, size_t length) {
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+InternPool *intern_pool_create(void) {
+    InternPool *pool = (InternPool*)calloc(1, sizeof(InternPool));
+    if (!pool) return NULL;
+    pool->capacity = 256;
+    pool->slot_capacity = 512;
+    pool->strings = (const char**)malloc(pool->capacity * sizeof(const char*));
+    pool->hashes = (unsigned int*)malloc(pool->capacity * sizeof(unsigned int));
+    pool->slots = (InternId*)calloc(pool->slot_capacity, sizeof(InternId));
+    if (!pool->strings || !pool->hashes || !pool->slots) {
+        intern_pool_destroy(pool);
+        return NULL;
+    }
+    pool->strings[0] = NULL;
+    pool->hashes[0] = 0;
+    pool->count = 1;
+    for (InternId id = 1; id < INTERN_WELL_KNOWN_END; id++) {
+        if (intern_id(pool, well_known[id]) != id) {
+            intern_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void intern_pool_destroy(InternPool *pool) {
+    if (!pool) return;
+    InternBlock *b = pool->blocks;
+    while (b) {
+        InternBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    free(pool->strings);
+    free(pool->hashes);
+    free(pool->slots);
+    free(pool);
+}
+
+static char *intern_store(InternPool *pool, const char *s, size_t length) {
+    InternBlock *b = pool->blocks;
+    if (!b || b->size - b->used < length + 1) {
+        size_t size = length + 1 > INTERN_BLOCK_SIZE ? length + 1 : INTERN_BLOCK_SIZE;
+        InternBlock *fresh = (InternBlock*)malloc(sizeof(InternBlock) + size);
+        if (!fresh) return NULL;
+        fresh->used = 0;
+        fresh->size = size;
+        fresh->next = b;
+        pool->blocks = b = fresh;
+    }
+    char *copy = b->data + b->used;
+    memcpy(copy, s, length);
+    copy[length] = '\0';
+    b->used += length + 1;
+    return copy;
+}
+
+static int intern_grow(InternPool *pool) {
+    if (pool->count == pool->capacity) {
+        unsigned int capacity = pool->capacity * 2;
+        const char **strings = (const char**)realloc(pool->strings, capacity * sizeof(const char*));
+        if (!strings) return -1;
+        pool->strings = strings;
+        unsigned int *hashes = (unsigned int*)realloc(pool->hashes, capacity * sizeof(unsigned int));
+        if (!hashes) return -1;
+        pool->hashes = hashes;
+        pool->capacity = capacity;
+    }
+    if ((pool->count + 1) * 2 > pool->slot_capacity) {
+        unsigned int slot_capacity = pool->slot_capacity * 2;
+        InternId *slots = (InternId*)calloc(slot_capacity, sizeof(InternId));
+        if (!slots) return -1;
+        for (InternId id = 1; id < pool->count; id++) {
+            unsigned int pos = pool->hashes[id] & (slot_capacity - 1);
+            while (slots[pos]) pos = (pos + 1) & (slot_capacity - 1);
+            slots[pos] = id;
+        }
+        free(pool->slots);
+        pool->slots = slots;
+        pool->slot_capacity = slot_capacity;
+    }
+    return 0;
+}
+
+InternId intern_id_n(InternPool *pool, const char *s, size_t length) {
+    unsigned int hash = intern_hash(s, length);
+    unsigned int mask = pool->slot_capacity - 1;
+    unsigned int pos = hash & mask;
+    for (InternId id; (id = pool->slots[pos]) != 0; pos = (pos + 1) & mask) {
+        const char *existing = pool->strings[id];
+        if (pool->hashes[id] == hash && strncmp(existing, s, length) == 0 && existing[length] == '\0')
+            return id;
+    }
+    if (intern_grow(pool) != 0) return 0;
+    char *copy = intern_store(pool, s, length);
+    if (!copy) return 0;
+    InternId id = pool->count++;
+    pool->strings[id] = copy;
+    pool->hashes[id] = hash;
+    /* the slot table may have been rebuilt by intern_grow */
+    mask = pool->slot_capacity - 1;
+    pos = hash & mask;
+    while (pool->slots[pos]) pos = (pos + 1) & mask;
+    pool->slots[pos] = id;
+    return id;
+}
+
+InternId intern_id(InternPool *pool, const char *s) {
+    return s ? intern_id_n(pool, s, strlen(s)) : 0;
+}
+
+const char *intern_str(const InternPool *pool, InternId id) {
+    return id < pool->count ? pool->strings[id] : NULL;
+}
@@ -0,0 +1,51 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+
+/* string interning: each distinct string is stored once and named by a
+   small id; equal strings get equal ids and the same stable pointer */
+typedef unsigned int InternId;   /* 0 is reserved for "no string" */
+
+typedef struct InternPool InternPool;
+
+/* spellings every pool interns on creation, in this order, so the compiler
+   can compare against them without a lookup */
+enum {
+    INTERN_INT = 1,
+    INTERN_FLOAT,
+    INTERN_VOID,
+    INTERN_STRING,
+    INTERN_NIL,                    /* "<nil>": no declared type */
+    INTERN_VOID_VALUE,             /* "<void>": no expression */
+    INTERN_ERROR,                  /* "<error>": already reported */
+    INTERN_PLUS,
+    INTERN_MINUS,
+    INTERN_TIMES,
+    INTERN_DIVIDE,
+    INTERN_AND,
+    INTERN_OR,
+    INTERN_NOT,
+    INTERN_EQ,
+    INTERN_NE,
+    INTERN_LT,
+    INTERN_GT,
+    INTERN_LE,
+    INTERN_GE,
+    INTERN_INDEX,                  /* "[]" */
+    INTERN_CONSTRUCTOR,
+    INTERN_SELF,
+    INTERN_GLOBAL,
+    INTERN_PUBLIC,
+    INTERN_PRIVATE,
+    INTERN_WELL_KNOWN_END
+};
+
+InternPool *intern_pool_create(void);
+void intern_pool_destroy(InternPool *pool);
+InternId intern_id(InternPool *pool, const char *s);
+InternId intern_id_n(InternPool *pool, const char *s, size_t length);
+/* NULL for id 0; valid until the pool is destroyed */
+const char *intern_str(const InternPool *pool, InternId id);
+
+#endif
@@ -4,23 +4,30 @@
 #include <string.h>
 
 typedef struct LexSymbolEntry {
-    char *lexeme;
+    InternId lexeme;
     LexSymbolKind kind;
+    unsigned int hash;
     int first_line;
     int first_column;
     int count;
-    struct LexSymbolEntry *next;
 } LexSymbolEntry;
 
+/* fixed-size trace record; the lexeme is a slice of the source buffer or,
+   when the scanner is not reading from one, of lexeme_pool; the name is an
+   index into token_names */
 typedef struct TokenRecord {
     int tokenType;
-    char *tokenName;
-    char *lexeme;
+    short nameIndex;
+    short inSource;
+    unsigned int offset;
+    unsigned int length;
     int line;
     int column;
-    struct TokenRecord *next;
 } TokenRecord;
 
+#define MAX_TOKEN_NAMES 128
+#define MAX_TOKEN_TYPES 512
+
 typedef struct LexError {
     char *message;
     int line;
@@ -28,11 +35,36 @@ typedef struct LexError {
     struct LexError *next;
 } LexError;
 
-static LexSymbolEntry *symbol_head = NULL;
-static TokenRecord *token_head = NULL;
-static TokenRecord *token_tail = NULL;
-static LexError *error_head = NULL;
-static LexError *error_tail = NULL;
+/* all state for one compilation's scanner logs */
+struct LexSupport {
+    InternPool *names;
+    /* symbols are kept in first-seen order; symbol_slots is an open-addressing
+       index over (kind, lexeme) holding entry index + 1 (0 marks an empty slot) */
+    LexSymbolEntry *symbols;
+    int symbol_count;
+    int symbol_capacity;
+    int *symbol_slots;
+    int slot_capacity;
+    TokenRecord *tokens;
+    size_t token_count;
+    size_t token_capacity;
+    const char *source_base;
+    size_t source_length;
+    char *lexeme_pool;
+    size_t pool_size;
+    size_t pool_capacity;
+    /* token names are registered once per token type; the scanner passes
+       string literals, so only the pointers are kept */
+    const char *token_names[MAX_TOKEN_NAMES];
+    int token_name_count;
+    short token_name_by_type[MAX_TOKEN_TYPES];
+    ArtifactMode token_mode;
+    ArtifactMode symbol_mode;
+    FILE *token_stream;
+    FILE *symbol_stream;
+    LexError *error_head;
+    LexError *error_tail;
+};
 
 static char *dup_string(const char *s) {
     if (!s) return NULL;
@@ -43,139 +75,244 @@ static char *dup_string(const char *s) {
     return copy;
 }
 
-void lex_support_init(void) {
-    lex_support_finalize();
+static const char *symbol_kind_name(LexSymbolKind kind) {
+    return (kind == LEXSYM_IDENTIFIER) ? "identifier" :
+           (kind == LEXSYM_INT_LITERAL) ? "int_literal" :
+           (kind == LEXSYM_FLOAT_LITERAL) ? "float_literal" :
+           (kind == LEXSYM_STRING_LITERAL) ? "string_literal" :
+           "reserved";
+}
+
+LexSupport *lex_support_create(InternPool *names) {
+    LexSupport *ls = (LexSupport*)calloc(1, sizeof(LexSupport));
+    if (!ls) return NULL;
+    ls->names = names;
+    ls->token_mode = ARTIFACT_BUFFER;
+    ls->symbol_mode = ARTIFACT_BUFFER;
+    return ls;
+}
+
+void lex_support_set_source(LexSupport *ls, const char *base, size_t length) {
+    ls->source_base = base;
+    ls->source_length = base ? length : 0;
+}
+
+static int in_source(const LexSupport *ls, const char *lexeme, size_t len) {
+    return ls->source_base && lexeme >= ls->source_base &&
+           (size_t)(lexeme - ls->source_base) + len <= ls->source_length;
 }
 
-void lex_support_finalize(void) {
-    while (symbol_head) {
-        LexSymbolEntry *next = symbol_head->next;
-        free(symbol_head->lexeme);
-        free(symbol_head);
-        symbol_head = next;
+void lex_support_set_token_mode(LexSupport *ls, ArtifactMode mode, FILE *out) {
+    ls->token_mode = mode;
+    ls->token_stream = (mode == ARTIFACT_STREAM) ? out : NULL;
+    if (ls->token_stream) {
+        fprintf(ls->token_stream, "Token Trace\n");
+        fprintf(ls->token_stream, "===========\n");
     }
-    symbol_head = NULL;
-
-    while (token_head) {
-        TokenRecord *next = token_head->next;
-        free(token_head->tokenName);
-        free(token_head->lexeme);
-        free(token_head);
-        token_head = next;
+}
+
+/* a streamed symbol list reports each entry when it is first seen, so it
+   carries no occurrence count */
+void lex_support_set_symbol_mode(LexSupport *ls, ArtifactMode mode, FILE *out) {
+    ls->symbol_mode = mode;
+    ls->symbol_stream = (mode == ARTIFACT_STREAM) ? out : NULL;
+    if (ls->symbol_stream) {
+        fprintf(ls->symbol_stream, "Lexical Symbol Table\n");
+        fprintf(ls->symbol_stream, "====================\n");
     }
-    token_tail = NULL;
+}
 
-    while (error_head) {
-        LexError *next = error_head->next;
-        free(error_head->message);
-        free(error_head);
-        error_head = next;
+void lex_support_destroy(LexSupport *ls) {
+    if (!ls) return;
+    free(ls->symbols);
+    free(ls->symbol_slots);
+    free(ls->tokens);
+    free(ls->lexeme_pool);
+    while (ls->error_head) {
+        LexError *next = ls->error_head->next;
+        free(ls->error_head->message);
+        free(ls->error_head);
+        ls->error_head = next;
     }
-    error_tail = NULL;
+    free(ls);
 }
 
-static LexSymbolEntry *find_symbol(LexSymbolKind kind, const char *lexeme) {
-    for (LexSymbolEntry *p = symbol_head; p; p = p->next) {
-        if (p->kind == kind && strcmp(p->lexeme, lexeme) == 0) {
-            return p;
-        }
+/* multiplicative hash of the interned id, mixed with the kind so equal
+   spellings of different kinds land in different chains */
+static unsigned int hash_symbol(LexSymbolKind kind, InternId lexeme) {
+    return (lexeme * 2654435761u) ^ ((unsigned int)kind << 28);
+}
+
+static int grow_symbol_slots(LexSupport *ls) {
+    int capacity = ls->slot_capacity ? ls->slot_capacity * 2 : 64;
+    int *slots = (int*)calloc((size_t)capacity, sizeof(int));
+    if (!slots) return 0;
+    for (int i = 0; i < ls->symbol_count; i++) {
+        unsigned int pos = ls->symbols[i].hash & (unsigned int)(capacity - 1);
+        while (slots[pos]) pos = (pos + 1) & (unsigned int)(capacity - 1);
+        slots[pos] = i + 1;
     }
-    return NULL;
+    free(ls->symbol_slots);
+    ls->symbol_slots = slots;
+    ls->slot_capacity = capacity;
+    return 1;
 }
 
-void lex_support_record_symbol(LexSymbolKind kind, const char *lexeme, int line, int column) {
-    if (!lexeme) return;
-    LexSymbolEntry *entry = find_symbol(kind, lexeme);
-    if (entry) {
-        entry->count++;
-        return;
+void lex_support_record_symbol(LexSupport *ls, LexSymbolKind kind, InternId lexeme, int line, int column) {
+    if (!lexeme || ls->symbol_mode == ARTIFACT_OFF) return;
+    /* keep the load factor at or below 1/2 so probe chains stay short */
+    if ((ls->symbol_count + 1) * 2 > ls->slot_capacity && !grow_symbol_slots(ls)) return;
+
+    unsigned int hash = hash_symbol(kind, lexeme);
+    unsigned int mask = (unsigned int)(ls->slot_capacity - 1);
+    unsigned int pos = hash & mask;
+    while (ls->symbol_slots[pos]) {
+        LexSymbolEntry *entry = &ls->symbols[ls->symbol_slots[pos] - 1];
+        if (entry->lexeme == lexeme && entry->kind == kind) {
+            entry->count++;
+            return;
+        }
+        pos = (pos + 1) & mask;
     }
-    entry = (LexSymbolEntry*)malloc(sizeof(LexSymbolEntry));
-    if (!entry) return;
-    entry->lexeme = dup_string(lexeme);
+
+    if (ls->symbol_count == ls->symbol_capacity) {
+        int capacity = ls->symbol_capacity ? ls->symbol_capacity * 2 : 64;
+        LexSymbolEntry *grown = (LexSymbolEntry*)realloc(ls->symbols, (size_t)capacity * sizeof(LexSymbolEntry));
+        if (!grown) return;
+        ls->symbols = grown;
+        ls->symbol_capacity = capacity;
+    }
+    LexSymbolEntry *entry = &ls->symbols[ls->symbol_count];
+    entry->lexeme = lexeme;
     entry->kind = kind;
+    entry->hash = hash;
     entry->first_line = line;
     entry->first_column = column;
     entry->count = 1;
-    entry->next = symbol_head;
-    symbol_head = entry;
+    ls->symbol_slots[pos] = ++ls->symbol_count;
+    if (ls->symbol_stream) {
+        fprintf(ls->symbol_stream, "%-15s kind=%-15s first=%d:%d\n",
+                intern_str(ls->names, lexeme), symbol_kind_name(kind), line, column);
+    }
+}
+
+void lex_support_record_lexeme(LexSupport *ls, LexSymbolKind kind, const char *text, size_t length, int line, int column) {
+    if (!text || ls->symbol_mode == ARTIFACT_OFF) return;
+    lex_support_record_symbol(ls, kind, intern_id_n(ls->names, text, length), line, column);
+}
+
+/* returns the token_names index for tokenType, or -1 if it cannot be named */
+static int token_name_index(LexSupport *ls, int tokenType, const char *tokenName) {
+    if (!tokenName) return -1;
+    if (tokenType >= 0 && tokenType < MAX_TOKEN_TYPES && ls->token_name_by_type[tokenType])
+        return ls->token_name_by_type[tokenType] - 1;
+    if (ls->token_name_count == MAX_TOKEN_NAMES) return -1;
+    ls->token_names[ls->token_name_count] = tokenName;
+    if (tokenType >= 0 && tokenType < MAX_TOKEN_TYPES)
+        ls->token_name_by_type[tokenType] = (short)(ls->token_name_count + 1);
+    return ls->token_name_count++;
+}
+
+static int append_lexeme(LexSupport *ls, const char *lexeme, size_t len, unsigned int *offset) {
+    if (ls->pool_size + len > ls->pool_capacity) {
+        size_t capacity = ls->pool_capacity ? ls->pool_capacity : 4096;
+        while (capacity < ls->pool_size + len) capacity *= 2;
+        char *grown = (char*)realloc(ls->lexeme_pool, capacity);
+        if (!grown) return 0;
+        ls->lexeme_pool = grown;
+        ls->pool_capacity = capacity;
+    }
+    memcpy(ls->lexeme_pool + ls->pool_size, lexeme, len);
+    *offset = (unsigned int)ls->pool_size;
+    ls->pool_size += len;
+    return 1;
 }
 
-void lex_support_record_token(int tokenType, const char *tokenName, const char *lexeme, int line, int column) {
-    (void)tokenType;
-    TokenRecord *rec = (TokenRecord*)malloc(sizeof(TokenRecord));
-    if (!rec) return;
+void lex_support_record_token(LexSupport *ls, int tokenType, const char *tokenName, const char *lexeme, int line, int column) {
+    if (ls->token_mode == ARTIFACT_OFF) return;
+    if (ls->token_mode == ARTIFACT_STREAM) {
+        if (ls->token_stream) {
+            fprintf(ls->token_stream, "%4d:%-4d %-15s %s\n",
+                    line, column, tokenName ? tokenName : "<token>", lexeme ? lexeme : "");
+        }
+        return;
+    }
+    if (ls->token_count == ls->token_capacity) {
+        size_t capacity = ls->token_capacity ? ls->token_capacity * 2 : 1024;
+        TokenRecord *grown = (TokenRecord*)realloc(ls->tokens, capacity * sizeof(TokenRecord));
+        if (!grown) return;
+        ls->tokens = grown;
+        ls->token_capacity = capacity;
+    }
+    TokenRecord *rec = &ls->tokens[ls->token_count];
+    size_t len = lexeme ? strlen(lexeme) : 0;
+    rec->offset = 0;
+    rec->inSource = (short)(len > 0 && in_source(ls, lexeme, len));
+    if (rec->inSource) rec->offset = (unsigned int)(lexeme - ls->source_base);
+    else if (len > 0 && !append_lexeme(ls, lexeme, len, &rec->offset)) return;
     rec->tokenType = tokenType;
-    rec->tokenName = dup_string(tokenName);
-    rec->lexeme = lexeme ? dup_string(lexeme) : dup_string("");
+    rec->nameIndex = (short)token_name_index(ls, tokenType, tokenName);
+    rec->length = (unsigned int)len;
     rec->line = line;
     rec->column = column;
-    rec->next = NULL;
-    if (!token_head) {
-        token_head = token_tail = rec;
-    } else {
-        token_tail->next = rec;
-        token_tail = rec;
-    }
+    ls->token_count++;
 }
 
-void lex_support_record_error(const char *message, int line, int column) {
+void lex_support_record_error(LexSupport *ls, const char *message, int line, int column) {
     LexError *err = (LexError*)malloc(sizeof(LexError));
     if (!err) return;
     err->message = dup_string(message ? message : "");
     err->line = line;
     err->column = column;
     err->next = NULL;
-    if (!error_head) {
-        error_head = error_tail = err;
+    if (!ls->error_head) {
+        ls->error_head = ls->error_tail = err;
     } else {
-        error_tail->next = err;
-        error_tail = err;
+        ls->error_tail->next = err;
+        ls->error_tail = err;
     }
 }
 
-void lex_support_dump_symbols(FILE *out) {
-    if (!out) return;
+void lex_support_dump_symbols(const LexSupport *ls, FILE *out) {
+    if (!ls || !out || ls->symbol_mode != ARTIFACT_BUFFER) return;
     fprintf(out, "Lexical Symbol Table\n");
     fprintf(out, "====================\n");
-    for (LexSymbolEntry *p = symbol_head; p; p = p->next) {
-        const char *kind =
-            (p->kind == LEXSYM_IDENTIFIER) ? "identifier" :
-            (p->kind == LEXSYM_INT_LITERAL) ? "int_literal" :
-            (p->kind == LEXSYM_FLOAT_LITERAL) ? "float_literal" :
-            (p->kind == LEXSYM_STRING_LITERAL) ? "string_literal" :
-            "reserved";
+    /* most recently discovered first, matching the original list order */
+    for (int i = ls->symbol_count - 1; i >= 0; i--) {
+        const LexSymbolEntry *p = &ls->symbols[i];
         fprintf(out, "%-15s kind=%-15s first=%d:%d count=%d\n",
-                p->lexeme ? p->lexeme : "<nil>",
-                kind,
+                intern_str(ls->names, p->lexeme),
+                symbol_kind_name(p->kind),
                 p->first_line,
                 p->first_column,
                 p->count);
     }
 }
 
-void lex_support_dump_tokens(FILE *out) {
-    if (!out) return;
+void lex_support_dump_tokens(const LexSupport *ls, FILE *out) {
+    if (!ls || !out || ls->token_mode != ARTIFACT_BUFFER) return;
     fprintf(out, "Token Trace\n");
     fprintf(out, "===========\n");
-    for (TokenRecord *p = token_head; p; p = p->next) {
-        fprintf(out, "%4d:%-4d %-15s %s\n",
+    for (size_t i = 0; i < ls->token_count; i++) {
+        const TokenRecord *p = &ls->tokens[i];
+        fprintf(out, "%4d:%-4d %-15s %.*s\n",
                 p->line,
                 p->column,
-                p->tokenName ? p->tokenName : "<token>",
-                p->lexeme ? p->lexeme : "");
+                p->nameIndex >= 0 ? ls->token_names[p->nameIndex] : "<token>",
+                (int)p->length,
+                !p->length ? "" : (p->inSource ? ls->source_base : ls->lexeme_pool) + p->offset);
     }
 }
 
-void lex_support_dump_errors(FILE *out) {
-    if (!out) return;
-    if (!error_head) {
+void lex_support_dump_errors(const LexSupport *ls, FILE *out) {
+    if (!ls || !out) return;
+    if (!ls->error_head) {
         fprintf(out, "No lexical errors detected.\n");
         return;
     }
     fprintf(out, "Lexical Errors\n");
     fprintf(out, "==============\n");
-    for (LexError *p = error_head; p; p = p->next) {
+    for (LexError *p = ls->error_head; p; p = p->next) {
         fprintf(out, "%4d:%-4d %s\n", p->line, p->column, p->message ? p->message : "");
     }
 }
@@ -2,6 +2,8 @@
 #define LEXER_SUPPORT_H
 
 #include <stdio.h>
+#include <stddef.h>
+#include "intern.h"
 
 typedef enum {
     LEXSYM_IDENTIFIER,
@@ -11,13 +13,35 @@ typedef enum {
     LEXSYM_RESERVED
 } LexSymbolKind;
 
-void lex_support_init(void);
-void lex_support_record_symbol(LexSymbolKind kind, const char *lexeme, int line, int column);
-void lex_support_record_token(int tokenType, const char *tokenName, const char *lexeme, int line, int column);
-void lex_support_record_error(const char *message, int line, int column);
-void lex_support_dump_symbols(FILE *out);
-void lex_support_dump_tokens(FILE *out);
-void lex_support_dump_errors(FILE *out);
-void lex_support_finalize(void);
+/* how a diagnostic artifact (token trace, symbol list, derivation log) is produced */
+typedef enum {
+    ARTIFACT_OFF,     /* not recorded at all */
+    ARTIFACT_STREAM,  /* written incrementally while scanning/parsing */
+    ARTIFACT_BUFFER   /* kept in memory and written at the end */
+} ArtifactMode;
+
+/* per-compilation scanner logs: lexical symbols, token trace and errors */
+typedef struct LexSupport LexSupport;
+
+/* names is the compilation's intern pool; it is borrowed and must outlive ls */
+LexSupport *lex_support_create(InternPool *names);
+void lex_support_destroy(LexSupport *ls);
+/* out is only used in ARTIFACT_STREAM mode; both default to ARTIFACT_BUFFER */
+void lex_support_set_token_mode(LexSupport *ls, ArtifactMode mode, FILE *out);
+void lex_support_set_symbol_mode(LexSupport *ls, ArtifactMode mode, FILE *out);
+/* traced lexemes that lie inside [base, base+length) are kept as views rather
+   than copies; the buffer must stay alive until the logs are dumped */
+void lex_support_set_source(LexSupport *ls, const char *base, size_t length);
+/* lexeme is an id from the pool passed to lex_support_create */
+void lex_support_record_symbol(LexSupport *ls, LexSymbolKind kind, InternId lexeme, int line, int column);
+/* as above for text the scanner has not interned; it is interned only when
+   the symbol list is being recorded */
+void lex_support_record_lexeme(LexSupport *ls, LexSymbolKind kind, const char *text, size_t length, int line, int column);
+/* tokenName is stored by reference and must outlive the trace (a literal) */
+void lex_support_record_token(LexSupport *ls, int tokenType, const char *tokenName, const char *lexeme, int line, int column);
+void lex_support_record_error(LexSupport *ls, const char *message, int line, int column);
+void lex_support_dump_symbols(const LexSupport *ls, FILE *out);
+void lex_support_dump_tokens(const LexSupport *ls, FILE *out);
+void lex_support_dump_errors(const LexSupport *ls, FILE *out);
 
 #endif
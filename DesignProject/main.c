@@ -1,124 +1,67 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include "ast.h"
-#include "symbol_table.h"
-#include "lexer_support.h"
-#include "codegen.h"
+#include <string.h>
+#include "compiler.h"
+#include "batch.h"
 
-/* parser exposes astRoot and yyparse/yyin */
-extern AST *astRoot;
-extern int yyparse();
-extern FILE *yyin;
-FILE *derivation_file = NULL;
+/* parse "off", "stream" or "buffer"; returns 0 on an unknown mode */
+static int parse_artifact_mode(const char *text, ArtifactMode *mode) {
+    if (strcmp(text, "off") == 0) *mode = ARTIFACT_OFF;
+    else if (strcmp(text, "stream") == 0) *mode = ARTIFACT_STREAM;
+    else if (strcmp(text, "buffer") == 0) *mode = ARTIFACT_BUFFER;
+    else return 0;
+    return 1;
+}
 
-/* semantic functions */
-void semantic_passA(AST *root);
-void semantic_passB(AST *root);
-int semantic_error_total(void);
-extern SymTable *globalTable;
-extern FILE *errFile;
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--tokens=MODE] [--symbols=MODE] [--derivation=MODE] [--input=mmap|file] <sourcefile>\n", prog);
+    fprintf(stderr, "       %s --batch -o OUTDIR [-j N] [options] <sourcefile>...\n", prog);
+    fprintf(stderr, "  MODE is off, stream or buffer (defaults: tokens/symbols buffer, derivation stream)\n");
+    fprintf(stderr, "  --input=mmap scans a memory mapping of the source in place\n");
+    fprintf(stderr, "  --batch compiles every source on N workers (default: one per CPU),\n");
+    fprintf(stderr, "          writing OUTDIR/<name>.<artifact> for each <name>.src\n");
+}
 
 int main(int argc, char **argv) {
-    lex_support_init();
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <sourcefile>\n", argv[0]);
-        return 1;
+    BatchOptions batch;
+    memset(&batch, 0, sizeof(batch));
+    compile_options_init(&batch.base);
+    CompileOptions *opts = &batch.base;
+    int batchMode = 0;
+    int ok = 1;
+    batch.sources = (const char**)malloc((size_t)argc * sizeof(const char*));
+    if (!batch.sources) { fprintf(stderr, "Out of memory.\n"); return 1; }
+    for (int i = 1; i < argc && ok; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--tokens=", 9) == 0) ok = parse_artifact_mode(arg + 9, &opts->tokenMode);
+        else if (strncmp(arg, "--symbols=", 10) == 0) ok = parse_artifact_mode(arg + 10, &opts->symbolMode);
+        else if (strncmp(arg, "--derivation=", 13) == 0) ok = parse_artifact_mode(arg + 13, &opts->derivationMode);
+        else if (strcmp(arg, "--input=mmap") == 0) opts->mapInput = 1;
+        else if (strcmp(arg, "--input=file") == 0) opts->mapInput = 0;
+        else if (strcmp(arg, "--batch") == 0) batchMode = 1;
+        else if (strcmp(arg, "-o") == 0 && i + 1 < argc) batch.outputDir = argv[++i];
+        else if (strcmp(arg, "-j") == 0 && i + 1 < argc) ok = (batch.jobs = atoi(argv[++i])) > 0;
+        else if (arg[0] == '-') ok = 0;
+        else batch.sources[batch.sourceCount++] = arg;
+        if (!ok) fprintf(stderr, "Unknown or invalid argument '%s'\n", arg);
     }
-    FILE *f = fopen(argv[1], "r");
-    if (!f) { perror("fopen"); return 1; }
-    yyin = f;
-
-    derivation_file = fopen("derivation_steps.txt", "w");
-
-    if (yyparse() != 0) {
-        fprintf(stderr, "Parsing failed.\n");
-        fclose(f);
-        if (derivation_file) fclose(derivation_file);
-        lex_support_finalize();
+    /* a single compile takes exactly one source and writes into the cwd */
+    if (ok && batchMode) ok = batch.outputDir && batch.sourceCount > 0;
+    else if (ok) ok = !batch.outputDir && !batch.jobs && batch.sourceCount == 1;
+    if (!ok) {
+        usage(argv[0]);
+        free(batch.sources);
         return 1;
     }
-    fclose(f);
-    if (derivation_file) fflush(derivation_file);
-
-    if (!astRoot) {
-        fprintf(stderr, "No AST produced.\n");
-        if (derivation_file) fclose(derivation_file);
-        lex_support_finalize();
-        return 1;
-    }
-
-    printf("=== AST ===\n");
-    ast_print(astRoot, 0);
-
-    /* open semantic error file */
-    errFile = fopen("semantic_errors.txt", "w");
-    if (!errFile) errFile = stdout;
-
-    /* pass A: build symbol tables */
-    semantic_passA(astRoot);
-
-    /* write symbol table */
-    FILE *symout = fopen("symbol_table.txt", "w");
-    if (symout) {
-        symtable_print_all(globalTable, symout);
-        fclose(symout);
-    }
-
-    /* pass B: semantic checks */
-    semantic_passB(astRoot);
-    int semanticErrors = semantic_error_total();
-
-    /* lexical artifacts */
-    FILE *lexsym = fopen("lexer_symbols.txt", "w");
-    if (lexsym) {
-        lex_support_dump_symbols(lexsym);
-        fclose(lexsym);
-    }
-    FILE *toklog = fopen("lexer_tokens.txt", "w");
-    if (toklog) {
-        lex_support_dump_tokens(toklog);
-        fclose(toklog);
-    }
-    FILE *lexerr = fopen("lexer_errors.txt", "w");
-    if (lexerr) {
-        lex_support_dump_errors(lexerr);
-        fclose(lexerr);
-    }
-    lex_support_finalize();
-
-    if (semanticErrors == 0) {
-        /* generate Intermediate Representation */
-        if (codegen_generate_ir(astRoot, globalTable, "codegen.ir") == 0) {
-            printf("Intermediate Representation written to codegen.ir\n");
-        }
-        
-        /* generate Assembly Code */
-        if (codegen_generate(astRoot, globalTable, "codegen.asm") == 0) {
-            printf("Assembly code written to codegen.asm\n");
-            
-            /* generate Relocatable Machine Code */
-            if (codegen_generate_relocatable("codegen.asm", "codegen.reloc") == 0) {
-                printf("Relocatable machine code written to codegen.reloc\n");
-            }
-            
-            /* generate Absolute Machine Code */
-            if (codegen_generate_absolute("codegen.asm", "codegen.abs") == 0) {
-                printf("Absolute machine code written to codegen.abs\n");
-            }
-        } else {
-            fprintf(stderr, "Code generation failed.\n");
-        }
+    int status;
+    if (batchMode) {
+        status = batch_compile(&batch);
     } else {
-        printf("Skipping code generation due to %d semantic error(s).\n", semanticErrors);
-    }
-
-    if (errFile && errFile != stdout) fclose(errFile);
-    if (derivation_file) fclose(derivation_file);
-
-    printf("Done. See lexer_tokens.txt, lexer_symbols.txt, semantic_errors.txt, symbol_table.txt");
-    if (semanticErrors == 0) {
-        printf(", codegen.ir, codegen.asm, codegen.reloc, codegen.abs");
+        opts->sourcePath = batch.sources[0];
+        status = compiler_compile(opts);
+        /* semantic errors are reported in semantic_errors.txt, not the exit status */
+        if (status == COMPILE_SEMANTIC_ERRORS) status = 0;
     }
-    printf("\n");
-    return 0;
+    free(batch.sources);
+    return status;
 }
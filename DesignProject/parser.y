@@ -1,20 +1,31 @@
+%code requires {
+#include "ast.h"
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+struct CompilerContext;
+}
+
 %{
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "ast.h"
+#include "compiler.h"
+%}
 
-/* external lexer interface */
-extern int yylex();
-void yyerror(const char *s);
-extern FILE *yyin;
-extern int current_line;
-extern FILE *derivation_file;
-static void log_production(const char *rule);
+%code {
+/* reentrant lexer interface (scanner.l) */
+int yylex(YYSTYPE *yylval_param, YYLTYPE *yylloc_param, yyscan_t scanner);
+void yyerror(YYLTYPE *loc, yyscan_t scanner, struct CompilerContext *ctx, const char *s);
+static void log_production(struct CompilerContext *ctx, const char *rule);
+}
 
-/* expose AST root */
-AST *astRoot = NULL;
-%}
+/* pure parser: all state is in the scanner handle and the compilation context */
+%define api.pure full
+%lex-param {yyscan_t scanner}
+%parse-param {yyscan_t scanner} {struct CompilerContext *ctx}
 
 /* enable location tracking */
 %locations
@@ -23,15 +34,16 @@ AST *astRoot = NULL;
 %union {
     int iVal;
     double dVal;
-    char *sVal;
+    InternId id;       /* identifiers, string literals, type names */
+    OpCode op;
     AST *node;
 }
 
 /* tokens */
-%token <sVal> ID
+%token <id> ID
 %token <iVal> INT_LIT
 %token <dVal> FLOAT_LIT
-%token <sVal> STRING_LIT
+%token <id> STRING_LIT
 
 %token CLASS IMPLEMENT FUNC CONSTRUCT ATTRIBUTE PUBLIC PRIVATE RETURN READ WRITE IF ELSE WHILE VOID SELF ISA LOCAL THEN
 %token INTEGER_T FLOAT_T
@@ -53,8 +65,9 @@ AST *astRoot = NULL;
 %type <node> funcDef funcHead funcBody varDeclOrStmtList varDeclOrStmt
 %type <node> localVarDecl attributeDecl varDecl arraySizes arraySize statement assignStat
 %type <node> variable idnest idOrSelf indice indiceList
-%type <node> fParams fParamsTailList aParams aParamsTailList type returnType
-%type <sVal> addOp multOp sign
+%type <node> fParams fParamsTailList aParams aParamsTailList
+%type <id> type returnType
+%type <op> addOp multOp sign
 
 %%
 
@@ -62,14 +75,14 @@ AST *astRoot = NULL;
 prog:
       classOrImplOrFunc prog
       {
-          log_production("prog -> classOrImplOrFunc prog");
-          if (!astRoot) astRoot = ast_new(NODE_PROGRAM, NULL, @1.first_line);
-          if ($1) ast_append_child(astRoot, $1);
+          log_production(ctx, "prog -> classOrImplOrFunc prog");
+          if (!ctx->astRoot) ctx->astRoot = ast_new(ctx->astArena, NODE_PROGRAM, 0, @1.first_line);
+          if ($1) ast_append_child(ctx->astRoot, $1);
       }
     | /* empty */
       {
-          log_production("prog -> epsilon");
-          astRoot = ast_new(NODE_PROGRAM, NULL, 0);
+          log_production(ctx, "prog -> epsilon");
+          ctx->astRoot = ast_new(ctx->astArena, NODE_PROGRAM, 0, 0);
       }
 ;
 
@@ -77,17 +90,17 @@ prog:
 classOrImplOrFunc:
       classDecl
       {
-          log_production("classOrImplOrFunc -> classDecl");
+          log_production(ctx, "classOrImplOrFunc -> classDecl");
           $$ = $1;
       }
     | implDef
       {
-          log_production("classOrImplOrFunc -> implDef");
+          log_production(ctx, "classOrImplOrFunc -> implDef");
           $$ = $1;
       }
     | funcDef
       {
-          log_production("classOrImplOrFunc -> funcDef");
+          log_production(ctx, "classOrImplOrFunc -> funcDef");
           $$ = $1;
       }
 ;
@@ -96,8 +109,8 @@ classOrImplOrFunc:
 classDecl:
       CLASS ID classInherit LBRACE classBody RBRACE SEMICOLON
       {
-          log_production("classDecl -> CLASS id classInherit { classBody } ;");
-          AST *c = ast_new(NODE_CLASS_DECL, $2, @2.first_line);
+          log_production(ctx, "classDecl -> CLASS id classInherit { classBody } ;");
+          AST *c = ast_new(ctx->astArena, NODE_CLASS_DECL, $2, @2.first_line);
           if ($3) ast_append_child(c, $3);
           if ($5) ast_append_child(c, $5);
           $$ = c;
@@ -107,16 +120,16 @@ classDecl:
 classInherit:
       ISA ID moreIds
       {
-          log_production("classInherit -> ISA id moreIds");
-          AST *list = ast_new(NODE_CLASS_INHERIT_LIST, NULL, @2.first_line);
-          AST *idnode = ast_new(NODE_ID, $2, @2.first_line);
+          log_production(ctx, "classInherit -> ISA id moreIds");
+          AST *list = ast_new(ctx->astArena, NODE_CLASS_INHERIT_LIST, 0, @2.first_line);
+          AST *idnode = ast_new(ctx->astArena, NODE_ID, $2, @2.first_line);
           ast_append_child(list, idnode);
           if ($3) ast_append_child(list, $3);
           $$ = list;
       }
     | /* empty */
       {
-          log_production("classInherit -> epsilon");
+          log_production(ctx, "classInherit -> epsilon");
           $$ = NULL;
       }
 ;
@@ -124,14 +137,14 @@ classInherit:
 moreIds:
       COMMA ID moreIds
       {
-          log_production("moreIds -> , id moreIds");
-          AST *idn = ast_new(NODE_ID, $2, @2.first_line);
+          log_production(ctx, "moreIds -> , id moreIds");
+          AST *idn = ast_new(ctx->astArena, NODE_ID, $2, @2.first_line);
           if ($3) ast_append_child(idn, $3);
           $$ = idn;
       }
     | /* empty */
       {
-          log_production("moreIds -> epsilon");
+          log_production(ctx, "moreIds -> epsilon");
           $$ = NULL;
       }
 ;
@@ -140,27 +153,21 @@ moreIds:
 classBody:
       PUBLIC memberDecl classBody
       {
-          log_production("classBody -> PUBLIC memberDecl classBody");
-          if ($2) {
-              if ($2->typeName) free($2->typeName);
-              $2->typeName = strdup("public");
-          }
+          log_production(ctx, "classBody -> PUBLIC memberDecl classBody");
+          if ($2) ast_set_type_name($2, INTERN_PUBLIC);
           if ($3) ast_append_sibling(&$2, $3);
           $$ = $2;
       }
     | PRIVATE memberDecl classBody
       {
-          log_production("classBody -> PRIVATE memberDecl classBody");
-          if ($2) {
-              if ($2->typeName) free($2->typeName);
-              $2->typeName = strdup("private");
-          }
+          log_production(ctx, "classBody -> PRIVATE memberDecl classBody");
+          if ($2) ast_set_type_name($2, INTERN_PRIVATE);
           if ($3) ast_append_sibling(&$2, $3);
           $$ = $2;
       }
     | /* empty */
       {
-          log_production("classBody -> epsilon");
+          log_production(ctx, "classBody -> epsilon");
           $$ = NULL;
       }
 ;
@@ -169,12 +176,12 @@ classBody:
 memberDecl:
       funcDecl
       {
-          log_production("memberDecl -> funcDecl");
+          log_production(ctx, "memberDecl -> funcDecl");
           $$ = $1;
       }
     | attributeDecl
       {
-          log_production("memberDecl -> attributeDecl");
+          log_production(ctx, "memberDecl -> attributeDecl");
           $$ = $1;
       }
 ;
@@ -183,7 +190,7 @@ memberDecl:
 funcDecl:
       funcHead SEMICOLON
       {
-          log_production("funcDecl -> funcHead ;");
+          log_production(ctx, "funcDecl -> funcHead ;");
           $$ = $1;
       }
 ;
@@ -192,9 +199,9 @@ funcDecl:
 implDef:
       IMPLEMENT ID LBRACE implFuncs RBRACE
       {
-          log_production("implDef -> IMPLEMENT id { implFuncs }");
-          AST *n = ast_new(NODE_EMPTY, $2, @2.first_line);
-          if ($4) n->child = $4;
+          log_production(ctx, "implDef -> IMPLEMENT id { implFuncs }");
+          AST *n = ast_new(ctx->astArena, NODE_EMPTY, $2, @2.first_line);
+          if ($4) ast_set_child(n, $4);
           $$ = n;
       }
 ;
@@ -202,13 +209,13 @@ implDef:
 implFuncs:
       funcDef implFuncs
       {
-          log_production("implFuncs -> funcDef implFuncs");
+          log_production(ctx, "implFuncs -> funcDef implFuncs");
           $$ = $1;
           if ($2) ast_append_sibling(&$$, $2);
       }
     | /* empty */
       {
-          log_production("implFuncs -> epsilon");
+          log_production(ctx, "implFuncs -> epsilon");
           $$ = NULL;
       }
 ;
@@ -217,9 +224,9 @@ implFuncs:
 funcDef:
       funcHead funcBody
       {
-          log_production("funcDef -> funcHead funcBody");
+          log_production(ctx, "funcDef -> funcHead funcBody");
           AST *f = $1;
-          if ($2) f->extra = $2;
+          if ($2) ast_set_extra(f, $2);
           $$ = f;
       }
 ;
@@ -228,20 +235,17 @@ funcDef:
 funcHead:
       FUNC ID LPAREN fParams RPAREN ARROW returnType
       {
-          log_production("funcHead -> FUNC id ( fParams ) ARROW returnType");
-          AST *fn = ast_new(NODE_FUNC_DECL, $2, @2.first_line);
-          if ($7) {
-              fn->typeName = $7->name ? strdup($7->name) : NULL;
-              ast_free($7);
-          }
-          if ($4) fn->child = $4;
+          log_production(ctx, "funcHead -> FUNC id ( fParams ) ARROW returnType");
+          AST *fn = ast_new(ctx->astArena, NODE_FUNC_DECL, $2, @2.first_line);
+          ast_set_type_name(fn, $7);
+          if ($4) ast_set_child(fn, $4);
           $$ = fn;
       }
     | CONSTRUCT LPAREN fParams RPAREN
       {
-          log_production("funcHead -> CONSTRUCT ( fParams )");
-          AST *fn = ast_new(NODE_FUNC_DECL, "constructor", @1.first_line);
-          if ($3) fn->child = $3;
+          log_production(ctx, "funcHead -> CONSTRUCT ( fParams )");
+          AST *fn = ast_new(ctx->astArena, NODE_FUNC_DECL, INTERN_CONSTRUCTOR, @1.first_line);
+          if ($3) ast_set_child(fn, $3);
           $$ = fn;
       }
 ;
@@ -250,9 +254,9 @@ funcHead:
 funcBody:
       LBRACE varDeclOrStmtList RBRACE
       {
-          log_production("funcBody -> { varDeclOrStmtList }");
-          AST *b = ast_new(NODE_FUNC_BODY, NULL, @1.first_line);
-          if ($2) b->child = $2;
+          log_production(ctx, "funcBody -> { varDeclOrStmtList }");
+          AST *b = ast_new(ctx->astArena, NODE_FUNC_BODY, 0, @1.first_line);
+          if ($2) ast_set_child(b, $2);
           $$ = b;
       }
 ;
@@ -260,14 +264,14 @@ funcBody:
 varDeclOrStmtList:
       varDeclOrStmt varDeclOrStmtList
       {
-          log_production("varDeclOrStmtList -> varDeclOrStmt varDeclOrStmtList");
+          log_production(ctx, "varDeclOrStmtList -> varDeclOrStmt varDeclOrStmtList");
           AST *head = $1;
           if ($2) ast_append_sibling(&head, $2);
           $$ = head;
       }
     | /* empty */
       {
-          log_production("varDeclOrStmtList -> epsilon");
+          log_production(ctx, "varDeclOrStmtList -> epsilon");
           $$ = NULL;
       }
 ;
@@ -275,12 +279,12 @@ varDeclOrStmtList:
 varDeclOrStmt:
       localVarDecl
       {
-          log_production("varDeclOrStmt -> localVarDecl");
+          log_production(ctx, "varDeclOrStmt -> localVarDecl");
           $$ = $1;
       }
     | statement
       {
-          log_production("varDeclOrStmt -> statement");
+          log_production(ctx, "varDeclOrStmt -> statement");
           $$ = $1;
       }
 ;
@@ -288,7 +292,7 @@ varDeclOrStmt:
 localVarDecl:
       LOCAL varDecl
       {
-          log_production("localVarDecl -> LOCAL varDecl");
+          log_production(ctx, "localVarDecl -> LOCAL varDecl");
           $$ = $2;
       }
 ;
@@ -296,8 +300,8 @@ localVarDecl:
 attributeDecl:
       ATTRIBUTE varDecl
       {
-          log_production("attributeDecl -> ATTRIBUTE varDecl");
-          AST *attr = ast_new(NODE_ATTRIBUTE, NULL, @1.first_line);
+          log_production(ctx, "attributeDecl -> ATTRIBUTE varDecl");
+          AST *attr = ast_new(ctx->astArena, NODE_ATTRIBUTE, 0, @1.first_line);
           if ($2) ast_append_child(attr, $2);
           $$ = attr;
       }
@@ -306,12 +310,9 @@ attributeDecl:
 varDecl:
       ID COLON type arraySizes SEMICOLON
       {
-          log_production("varDecl -> id : type arraySizes ;");
-          AST *v = ast_new(NODE_VAR_DECL, $1, @1.first_line);
-          if ($3) {
-              v->typeName = $3->name ? strdup($3->name) : NULL;
-              ast_free($3);
-          }
+          log_production(ctx, "varDecl -> id : type arraySizes ;");
+          AST *v = ast_new(ctx->astArena, NODE_VAR_DECL, $1, @1.first_line);
+          ast_set_type_name(v, $3);
           $$ = v;
       }
 ;
@@ -319,12 +320,12 @@ varDecl:
 arraySizes:
       arraySize arraySizes
       {
-          log_production("arraySizes -> arraySize arraySizes");
+          log_production(ctx, "arraySizes -> arraySize arraySizes");
           $$ = NULL;
       }
     | /* empty */
       {
-          log_production("arraySizes -> epsilon");
+          log_production(ctx, "arraySizes -> epsilon");
           $$ = NULL;
       }
 ;
@@ -332,12 +333,12 @@ arraySizes:
 arraySize:
       LBRACKET INT_LIT RBRACKET
       {
-          log_production("arraySize -> [ INT ]");
-          $$ = ast_new_int($2, @2.first_line);
+          log_production(ctx, "arraySize -> [ INT ]");
+          $$ = ast_new_int(ctx->astArena, $2, @2.first_line);
       }
     | LBRACKET RBRACKET
       {
-          log_production("arraySize -> [ ]");
+          log_production(ctx, "arraySize -> [ ]");
           $$ = NULL;
       }
 ;
@@ -346,13 +347,13 @@ arraySize:
 statement:
       assignStat SEMICOLON
       {
-          log_production("statement -> assignStat ;");
+          log_production(ctx, "statement -> assignStat ;");
           $$ = $1;
       }
     | IF LPAREN expr RPAREN THEN statBlock ELSE statBlock SEMICOLON
       {
-          log_production("statement -> IF ( expr ) THEN statBlock ELSE statBlock ;");
-          AST *node = ast_new(NODE_IF, NULL, @1.first_line);
+          log_production(ctx, "statement -> IF ( expr ) THEN statBlock ELSE statBlock ;");
+          AST *node = ast_new(ctx->astArena, NODE_IF, 0, @1.first_line);
           ast_append_child(node, $3);
           ast_append_child(node, $6);
           ast_append_child(node, $8);
@@ -360,8 +361,8 @@ statement:
       }
     | IF LPAREN expr RPAREN THEN statBlock SEMICOLON
       {
-          log_production("statement -> IF ( expr ) THEN statBlock ;");
-          AST *node = ast_new(NODE_IF, NULL, @1.first_line);
+          log_production(ctx, "statement -> IF ( expr ) THEN statBlock ;");
+          AST *node = ast_new(ctx->astArena, NODE_IF, 0, @1.first_line);
           ast_append_child(node, $3);
           ast_append_child(node, $6);
           /* else block is NULL */
@@ -369,42 +370,42 @@ statement:
       }
     | WHILE LPAREN expr RPAREN statBlock SEMICOLON
       {
-          log_production("statement -> WHILE ( expr ) statBlock ;");
-          AST *node = ast_new(NODE_WHILE, NULL, @1.first_line);
+          log_production(ctx, "statement -> WHILE ( expr ) statBlock ;");
+          AST *node = ast_new(ctx->astArena, NODE_WHILE, 0, @1.first_line);
           ast_append_child(node, $3);
           ast_append_child(node, $5);
           $$ = node;
       }
     | READ LPAREN variable RPAREN SEMICOLON
       {
-          log_production("statement -> READ ( variable ) ;");
-          AST *n = ast_new(NODE_READ, NULL, @1.first_line);
+          log_production(ctx, "statement -> READ ( variable ) ;");
+          AST *n = ast_new(ctx->astArena, NODE_READ, 0, @1.first_line);
           ast_append_child(n, $3);
           $$ = n;
       }
     | WRITE LPAREN expr RPAREN SEMICOLON
       {
-          log_production("statement -> WRITE ( expr ) ;");
-          AST *n = ast_new(NODE_WRITE, NULL, @1.first_line);
+          log_production(ctx, "statement -> WRITE ( expr ) ;");
+          AST *n = ast_new(ctx->astArena, NODE_WRITE, 0, @1.first_line);
           ast_append_child(n, $3);
           $$ = n;
       }
     | RETURN LPAREN expr RPAREN SEMICOLON
       {
-          log_production("statement -> RETURN ( expr ) ;");
-          AST *n = ast_new(NODE_RETURN, NULL, @1.first_line);
+          log_production(ctx, "statement -> RETURN ( expr ) ;");
+          AST *n = ast_new(ctx->astArena, NODE_RETURN, 0, @1.first_line);
           ast_append_child(n, $3);
           $$ = n;
       }
     | functionCall SEMICOLON
       {
-          log_production("statement -> functionCall ;");
+          log_production(ctx, "statement -> functionCall ;");
           $$ = $1;
       }
     | error SEMICOLON
       {
-          log_production("statement -> error ;");
-          yyerror("Recovering from statement error");
+          log_production(ctx, "statement -> error ;");
+          yyerror(&@$, scanner, ctx, "Recovering from statement error");
           yyerrok;
           $$ = NULL;
       }
@@ -413,8 +414,8 @@ statement:
 assignStat:
       variable ASSIGN expr
       {
-          log_production("assignStat -> variable ASSIGN expr");
-          AST *assign = ast_new(NODE_ASSIGN, NULL, @1.first_line);
+          log_production(ctx, "assignStat -> variable ASSIGN expr");
+          AST *assign = ast_new(ctx->astArena, NODE_ASSIGN, 0, @1.first_line);
           ast_append_child(assign, $1);
           ast_append_child(assign, $3);
           $$ = assign;
@@ -424,33 +425,37 @@ assignStat:
 statementList:
       statement statementList
       {
-          log_production("statementList -> statement statementList");
+          log_production(ctx, "statementList -> statement statementList");
           AST *h = $1;
           if ($2) ast_append_sibling(&h, $2);
           $$ = h;
       }
     | /* empty */
       {
-          log_production("statementList -> epsilon");
+          log_production(ctx, "statementList -> epsilon");
           $$ = NULL;
       }
 ;
 
+/* a braced or empty block is one STATEMENT_LIST node, so the then and else
+   blocks stay apart among the IF node's children */
 statBlock:
       LBRACE statementList RBRACE
       {
-          log_production("statBlock -> { statementList }");
-          $$ = $2;
+          log_production(ctx, "statBlock -> { statementList }");
+          AST *block = ast_new(ctx->astArena, NODE_STATEMENT_LIST, 0, @1.first_line);
+          ast_set_child(block, $2);
+          $$ = block;
       }
     | statement
       {
-          log_production("statBlock -> statement");
+          log_production(ctx, "statBlock -> statement");
           $$ = $1;
       }
     | /* empty */
       {
-          log_production("statBlock -> epsilon");
-          $$ = NULL;
+          log_production(ctx, "statBlock -> epsilon");
+          $$ = ast_new(ctx->astArena, NODE_STATEMENT_LIST, 0, @$.first_line);
       }
 ;
 
@@ -458,15 +463,15 @@ statBlock:
 expr:
       relExpr exprPrime
       {
-          log_production("expr -> relExpr exprPrime");
+          log_production(ctx, "expr -> relExpr exprPrime");
           if ($2) {
               /* Build left-associative tree from right-recursive parse */
               AST *op = $2;
               AST *left = $1;
-              AST *right = op->child ? op->child->sibling : NULL;
-              op->child = left;
+              AST *right = ast_child(op) ? ast_sibling(ast_child(op)) : NULL;
+              ast_set_child(op, left);
               if (right) {
-                  op->child->sibling = right;
+                  ast_set_sibling(ast_child(op), right);
               }
               $$ = op;
           } else {
@@ -478,13 +483,13 @@ expr:
 exprPrime:
       AND relExpr exprPrime
       {
-          log_production("exprPrime -> AND relExpr exprPrime");
-          AST *op = ast_new(NODE_BINARY_OP, "and", @1.first_line);
-          op->child = $2;  /* right operand */
+          log_production(ctx, "exprPrime -> AND relExpr exprPrime");
+          AST *op = ast_new_op(ctx->astArena, NODE_BINARY_OP, OP_AND, @1.first_line);
+          ast_set_child(op, $2);  /* right operand */
           if ($3) {
               /* Chain: (left AND right) AND next */
               AST *chain = $3;
-              chain->child->sibling = op;  /* attach to chain */
+              ast_set_sibling(ast_child(chain), op);  /* attach to chain */
               $$ = chain;
           } else {
               $$ = op;
@@ -492,12 +497,12 @@ exprPrime:
       }
     | OR relExpr exprPrime
       {
-          log_production("exprPrime -> OR relExpr exprPrime");
-          AST *op = ast_new(NODE_BINARY_OP, "or", @1.first_line);
-          op->child = $2;
+          log_production(ctx, "exprPrime -> OR relExpr exprPrime");
+          AST *op = ast_new_op(ctx->astArena, NODE_BINARY_OP, OP_OR, @1.first_line);
+          ast_set_child(op, $2);
           if ($3) {
               AST *chain = $3;
-              chain->child->sibling = op;
+              ast_set_sibling(ast_child(chain), op);
               $$ = chain;
           } else {
               $$ = op;
@@ -505,7 +510,7 @@ exprPrime:
       }
     | /* empty */
       {
-          log_production("exprPrime -> epsilon");
+          log_production(ctx, "exprPrime -> epsilon");
           $$ = NULL;
       }
 ;
@@ -513,55 +518,55 @@ exprPrime:
 relExpr:
       arithExpr EQ arithExpr
       {
-          log_production("relExpr -> arithExpr == arithExpr");
-          AST *n = ast_new(NODE_BINARY_OP, "==", @2.first_line);
+          log_production(ctx, "relExpr -> arithExpr == arithExpr");
+          AST *n = ast_new_op(ctx->astArena, NODE_BINARY_OP, OP_EQ, @2.first_line);
           ast_append_child(n, $1);
           ast_append_child(n, $3);
           $$ = n;
       }
     | arithExpr NE arithExpr
       {
-          log_production("relExpr -> arithExpr <> arithExpr");
-          AST *n = ast_new(NODE_BINARY_OP, "<>", @2.first_line);
+          log_production(ctx, "relExpr -> arithExpr <> arithExpr");
+          AST *n = ast_new_op(ctx->astArena, NODE_BINARY_OP, OP_NE, @2.first_line);
           ast_append_child(n, $1);
           ast_append_child(n, $3);
           $$ = n;
       }
     | arithExpr LT arithExpr
       {
-          log_production("relExpr -> arithExpr < arithExpr");
-          AST *n = ast_new(NODE_BINARY_OP, "<", @2.first_line);
+          log_production(ctx, "relExpr -> arithExpr < arithExpr");
+          AST *n = ast_new_op(ctx->astArena, NODE_BINARY_OP, OP_LT, @2.first_line);
           ast_append_child(n, $1);
           ast_append_child(n, $3);
           $$ = n;
       }
     | arithExpr GT arithExpr
       {
-          log_production("relExpr -> arithExpr > arithExpr");
-          AST *n = ast_new(NODE_BINARY_OP, ">", @2.first_line);
+          log_production(ctx, "relExpr -> arithExpr > arithExpr");
+          AST *n = ast_new_op(ctx->astArena, NODE_BINARY_OP, OP_GT, @2.first_line);
           ast_append_child(n, $1);
           ast_append_child(n, $3);
           $$ = n;
       }
     | arithExpr LE arithExpr
       {
-          log_production("relExpr -> arithExpr <= arithExpr");
-          AST *n = ast_new(NODE_BINARY_OP, "<=", @2.first_line);
+          log_production(ctx, "relExpr -> arithExpr <= arithExpr");
+          AST *n = ast_new_op(ctx->astArena, NODE_BINARY_OP, OP_LE, @2.first_line);
           ast_append_child(n, $1);
           ast_append_child(n, $3);
           $$ = n;
       }
     | arithExpr GE arithExpr
       {
-          log_production("relExpr -> arithExpr >= arithExpr");
-          AST *n = ast_new(NODE_BINARY_OP, ">=", @2.first_line);
+          log_production(ctx, "relExpr -> arithExpr >= arithExpr");
+          AST *n = ast_new_op(ctx->astArena, NODE_BINARY_OP, OP_GE, @2.first_line);
           ast_append_child(n, $1);
           ast_append_child(n, $3);
           $$ = n;
       }
     | arithExpr
       {
-          log_production("relExpr -> arithExpr");
+          log_production(ctx, "relExpr -> arithExpr");
           $$ = $1;
       }
 ;
@@ -569,14 +574,14 @@ relExpr:
 arithExpr:
       term arithExprPrime
       {
-          log_production("arithExpr -> term arithExprPrime");
+          log_production(ctx, "arithExpr -> term arithExprPrime");
           if ($2) {
               AST *op = $2;
               AST *left = $1;
-              AST *right = op->child;
-              op->child = left;
+              AST *right = ast_child(op);
+              ast_set_child(op, left);
               if (right) {
-                  op->child->sibling = right;
+                  ast_set_sibling(ast_child(op), right);
               }
               $$ = op;
           } else {
@@ -588,21 +593,20 @@ arithExpr:
 arithExprPrime:
       addOp term arithExprPrime
       {
-          log_production("arithExprPrime -> addOp term arithExprPrime");
-          AST *op = ast_new(NODE_BINARY_OP, $1, @1.first_line);
-          op->child = $2;  /* right operand (term) */
+          log_production(ctx, "arithExprPrime -> addOp term arithExprPrime");
+          AST *op = ast_new_op(ctx->astArena, NODE_BINARY_OP, $1, @1.first_line);
+          ast_set_child(op, $2);  /* right operand (term) */
           if ($3) {
               AST *chain = $3;
-              chain->child->sibling = op;
+              ast_set_sibling(ast_child(chain), op);
               $$ = chain;
           } else {
               $$ = op;
           }
-          free($1);
       }
     | /* empty */
       {
-          log_production("arithExprPrime -> epsilon");
+          log_production(ctx, "arithExprPrime -> epsilon");
           $$ = NULL;
       }
 ;
@@ -610,32 +614,32 @@ arithExprPrime:
 addOp:
       PLUS
       {
-          log_production("addOp -> +");
-          $$ = strdup("+");
+          log_production(ctx, "addOp -> +");
+          $$ = OP_ADD;
       }
     | MINUS
       {
-          log_production("addOp -> -");
-          $$ = strdup("-");
+          log_production(ctx, "addOp -> -");
+          $$ = OP_SUB;
       }
     | OR
       {
-          log_production("addOp -> or");
-          $$ = strdup("or");
+          log_production(ctx, "addOp -> or");
+          $$ = OP_OR;
       }
 ;
 
 term:
       factor termPrime
       {
-          log_production("term -> factor termPrime");
+          log_production(ctx, "term -> factor termPrime");
           if ($2) {
               AST *op = $2;
               AST *left = $1;
-              AST *right = op->child;
-              op->child = left;
+              AST *right = ast_child(op);
+              ast_set_child(op, left);
               if (right) {
-                  op->child->sibling = right;
+                  ast_set_sibling(ast_child(op), right);
               }
               $$ = op;
           } else {
@@ -647,21 +651,20 @@ term:
 termPrime:
       multOp factor termPrime
       {
-          log_production("termPrime -> multOp factor termPrime");
-          AST *op = ast_new(NODE_BINARY_OP, $1, @1.first_line);
-          op->child = $2;  /* right operand (factor) */
+          log_production(ctx, "termPrime -> multOp factor termPrime");
+          AST *op = ast_new_op(ctx->astArena, NODE_BINARY_OP, $1, @1.first_line);
+          ast_set_child(op, $2);  /* right operand (factor) */
           if ($3) {
               AST *chain = $3;
-              chain->child->sibling = op;
+              ast_set_sibling(ast_child(chain), op);
               $$ = chain;
           } else {
               $$ = op;
           }
-          free($1);
       }
     | /* empty */
       {
-          log_production("termPrime -> epsilon");
+          log_production(ctx, "termPrime -> epsilon");
           $$ = NULL;
       }
 ;
@@ -669,64 +672,63 @@ termPrime:
 multOp:
       MULT
       {
-          log_production("multOp -> *");
-          $$ = strdup("*");
+          log_production(ctx, "multOp -> *");
+          $$ = OP_MUL;
       }
     | DIV
       {
-          log_production("multOp -> /");
-          $$ = strdup("/");
+          log_production(ctx, "multOp -> /");
+          $$ = OP_DIV;
       }
     | AND
       {
-          log_production("multOp -> and");
-          $$ = strdup("and");
+          log_production(ctx, "multOp -> and");
+          $$ = OP_AND;
       }
 ;
 
 factor:
       variable
       {
-          log_production("factor -> variable");
+          log_production(ctx, "factor -> variable");
           $$ = $1;
       }
     | functionCall
       {
-          log_production("factor -> functionCall");
+          log_production(ctx, "factor -> functionCall");
           $$ = $1;
       }
     | INT_LIT
       {
-          log_production("factor -> INT_LIT");
-          AST *n = ast_new(NODE_INT_LITERAL, NULL, @1.first_line);
+          log_production(ctx, "factor -> INT_LIT");
+          AST *n = ast_new(ctx->astArena, NODE_INT_LITERAL, 0, @1.first_line);
           n->intValue = $1;
           $$ = n;
       }
     | FLOAT_LIT
       {
-          log_production("factor -> FLOAT_LIT");
-          AST *n = ast_new(NODE_FLOAT_LITERAL, NULL, @1.first_line);
+          log_production(ctx, "factor -> FLOAT_LIT");
+          AST *n = ast_new(ctx->astArena, NODE_FLOAT_LITERAL, 0, @1.first_line);
           n->floatValue = $1;
           $$ = n;
       }
     | LPAREN arithExpr RPAREN
       {
-          log_production("factor -> ( arithExpr )");
+          log_production(ctx, "factor -> ( arithExpr )");
           $$ = $2;
       }
     | NOT factor
       {
-          log_production("factor -> NOT factor");
-          AST *n = ast_new(NODE_UNARY_OP, "not", @1.first_line);
+          log_production(ctx, "factor -> NOT factor");
+          AST *n = ast_new_op(ctx->astArena, NODE_UNARY_OP, OP_NOT, @1.first_line);
           ast_append_child(n, $2);
           $$ = n;
       }
     | sign factor
       {
-          log_production("factor -> sign factor");
-          AST *n = ast_new(NODE_UNARY_OP, $1, @1.first_line);
+          log_production(ctx, "factor -> sign factor");
+          AST *n = ast_new_op(ctx->astArena, NODE_UNARY_OP, $1, @1.first_line);
           ast_append_child(n, $2);
-          free($1);
           $$ = n;
       }
 ;
@@ -735,13 +737,13 @@ factor:
 sign:
       PLUS
       {
-          log_production("sign -> +");
-          $$ = strdup("+");
+          log_production(ctx, "sign -> +");
+          $$ = OP_POS;
       }
     | MINUS
       {
-          log_production("sign -> -");
-          $$ = strdup("-");
+          log_production(ctx, "sign -> -");
+          $$ = OP_NEG;
       }
 ;
 
@@ -750,23 +752,23 @@ sign:
 functionCall:
       ID LPAREN aParams RPAREN
       {
-          log_production("functionCall -> id ( aParams )");
-          AST *c = ast_new(NODE_FUNCTION_CALL, $1, @1.first_line);
-          if ($3) c->child = $3;
+          log_production(ctx, "functionCall -> id ( aParams )");
+          AST *c = ast_new(ctx->astArena, NODE_FUNCTION_CALL, $1, @1.first_line);
+          if ($3) ast_set_child(c, $3);
           $$ = c;
       }
     | idnest DOT functionCall
       {
-          log_production("functionCall -> idnest . functionCall");
+          log_production(ctx, "functionCall -> idnest . functionCall");
           AST *c = $3;
           if ($1) {
-              if (c->child) {
+              if (ast_child(c)) {
                   AST *last = $1;
-                  while (last->sibling) last = last->sibling;
-                  last->sibling = c->child;
-                  c->child = $1;
+                  while (ast_sibling(last)) last = ast_sibling(last);
+                  ast_set_sibling(last, ast_child(c));
+                  ast_set_child(c, $1);
               } else {
-                  c->child = $1;
+                  ast_set_child(c, $1);
               }
           }
           $$ = c;
@@ -778,19 +780,19 @@ functionCall:
 variable:
       ID indiceList
       {
-          log_production("variable -> id indiceList");
-          AST *var = ast_new(NODE_ID, $1, @1.first_line);
-          if ($2) var->sibling = $2;
+          log_production(ctx, "variable -> id indiceList");
+          AST *var = ast_new(ctx->astArena, NODE_ID, $1, @1.first_line);
+          if ($2) ast_set_sibling(var, $2);
           $$ = var;
       }
     | idnest DOT variable
       {
-          log_production("variable -> idnest . variable");
+          log_production(ctx, "variable -> idnest . variable");
           AST *var = $3;
           if ($1) {
               AST *last = $1;
-              while (last->sibling) last = last->sibling;
-              last->sibling = var;
+              while (ast_sibling(last)) last = ast_sibling(last);
+              ast_set_sibling(last, var);
               var = $1;
           }
           $$ = var;
@@ -803,24 +805,24 @@ variable:
 idnest:
       idOrSelf indiceList DOT
       {
-          log_production("idnest -> idOrSelf indiceList .");
+          log_production(ctx, "idnest -> idOrSelf indiceList .");
           AST *n = $1;
           if ($2) {
-              if (n->sibling) {
+              if (ast_sibling(n)) {
                   AST *last = n;
-                  while (last->sibling) last = last->sibling;
-                  last->sibling = $2;
+                  while (ast_sibling(last)) last = ast_sibling(last);
+                  ast_set_sibling(last, $2);
               } else {
-                  n->sibling = $2;
+                  ast_set_sibling(n, $2);
               }
           }
           $$ = n;
       }
     | idOrSelf LPAREN aParams RPAREN DOT
       {
-          log_production("idnest -> idOrSelf ( aParams ) .");
-          AST *call = ast_new(NODE_FUNCTION_CALL, $1->name, @1.first_line);
-          call->child = $3;
+          log_production(ctx, "idnest -> idOrSelf ( aParams ) .");
+          AST *call = ast_new(ctx->astArena, NODE_FUNCTION_CALL, $1->nameId, @1.first_line);
+          ast_set_child(call, $3);
           $$ = call;
       }
 ;
@@ -829,13 +831,13 @@ idnest:
 idOrSelf:
       ID
       {
-          log_production("idOrSelf -> id");
-          $$ = ast_new(NODE_ID, $1, @1.first_line);
+          log_production(ctx, "idOrSelf -> id");
+          $$ = ast_new(ctx->astArena, NODE_ID, $1, @1.first_line);
       }
     | SELF
       {
-          log_production("idOrSelf -> self");
-          $$ = ast_new(NODE_ID, "self", @1.first_line);
+          log_production(ctx, "idOrSelf -> self");
+          $$ = ast_new(ctx->astArena, NODE_ID, INTERN_SELF, @1.first_line);
       }
 ;
 
@@ -843,14 +845,14 @@ idOrSelf:
 indiceList:
       indice indiceList
       {
-          log_production("indiceList -> indice indiceList");
+          log_production(ctx, "indiceList -> indice indiceList");
           AST *head = $1;
           if ($2) ast_append_sibling(&head, $2);
           $$ = head;
       }
     | /* empty */
       {
-          log_production("indiceList -> epsilon");
+          log_production(ctx, "indiceList -> epsilon");
           $$ = NULL;
       }
 ;
@@ -859,8 +861,8 @@ indiceList:
 indice:
       LBRACKET arithExpr RBRACKET
       {
-          log_production("indice -> [ arithExpr ]");
-          AST *idx = ast_new(NODE_BINARY_OP, "[]", @1.first_line);
+          log_production(ctx, "indice -> [ arithExpr ]");
+          AST *idx = ast_new_op(ctx->astArena, NODE_BINARY_OP, OP_INDEX, @1.first_line);
           ast_append_child(idx, $2);
           $$ = idx;
       }
@@ -870,18 +872,15 @@ indice:
 fParams:
       ID COLON type arraySizes fParamsTailList
       {
-          log_production("fParams -> id : type arraySizes fParamsTailList");
-          AST *p = ast_new(NODE_PARAM, $1, @1.first_line);
-          if ($3) {
-              p->typeName = $3->name ? strdup($3->name) : NULL;
-              ast_free($3);
-          }
+          log_production(ctx, "fParams -> id : type arraySizes fParamsTailList");
+          AST *p = ast_new(ctx->astArena, NODE_PARAM, $1, @1.first_line);
+          ast_set_type_name(p, $3);
           if ($5) ast_append_sibling(&p, $5);
           $$ = p;
       }
     | /* empty */
       {
-          log_production("fParams -> epsilon");
+          log_production(ctx, "fParams -> epsilon");
           $$ = NULL;
       }
 ;
@@ -889,18 +888,15 @@ fParams:
 fParamsTailList:
       COMMA ID COLON type arraySizes fParamsTailList
       {
-          log_production("fParamsTailList -> , id : type arraySizes fParamsTailList");
-          AST *p = ast_new(NODE_PARAM, $2, @2.first_line);
-          if ($4) {
-              p->typeName = $4->name ? strdup($4->name) : NULL;
-              ast_free($4);
-          }
+          log_production(ctx, "fParamsTailList -> , id : type arraySizes fParamsTailList");
+          AST *p = ast_new(ctx->astArena, NODE_PARAM, $2, @2.first_line);
+          ast_set_type_name(p, $4);
           if ($6) ast_append_sibling(&p, $6);
           $$ = p;
       }
     | /* empty */
       {
-          log_production("fParamsTailList -> epsilon");
+          log_production(ctx, "fParamsTailList -> epsilon");
           $$ = NULL;
       }
 ;
@@ -908,14 +904,14 @@ fParamsTailList:
 aParams:
       expr aParamsTailList
       {
-          log_production("aParams -> expr aParamsTailList");
+          log_production(ctx, "aParams -> expr aParamsTailList");
           AST *h = $1;
           if ($2) ast_append_sibling(&h, $2);
           $$ = h;
       }
     | /* empty */
       {
-          log_production("aParams -> epsilon");
+          log_production(ctx, "aParams -> epsilon");
           $$ = NULL;
       }
 ;
@@ -923,68 +919,93 @@ aParams:
 aParamsTailList:
       COMMA expr aParamsTailList
       {
-          log_production("aParamsTailList -> , expr aParamsTailList");
+          log_production(ctx, "aParamsTailList -> , expr aParamsTailList");
           AST *n = $2;
           if ($3) ast_append_sibling(&n, $3);
           $$ = n;
       }
     | /* empty */
       {
-          log_production("aParamsTailList -> epsilon");
+          log_production(ctx, "aParamsTailList -> epsilon");
           $$ = NULL;
       }
 ;
 
-/* Normalize type names */
+/* Normalize type names; the name is a literal or the arena copy of the id */
 type:
       INTEGER_T
       {
-          log_production("type -> INTEGER");
-          AST *t = ast_new(NODE_TYPE, "int", @1.first_line);
-          $$ = t;
+          log_production(ctx, "type -> INTEGER");
+          $$ = INTERN_INT;
       }
     | FLOAT_T
       {
-          log_production("type -> FLOAT");
-          AST *t = ast_new(NODE_TYPE, "float", @1.first_line);
-          $$ = t;
+          log_production(ctx, "type -> FLOAT");
+          $$ = INTERN_FLOAT;
       }
     | ID
       {
-          log_production("type -> id");
-          AST *t = ast_new(NODE_TYPE, $1, @1.first_line);
-          $$ = t;
+          log_production(ctx, "type -> id");
+          $$ = $1;
       }
     | /* empty */
       {
-          log_production("type -> epsilon");
-          $$ = NULL;
+          log_production(ctx, "type -> epsilon");
+          $$ = 0;
       }
 ;
 
 returnType:
       type
       {
-          log_production("returnType -> type");
+          log_production(ctx, "returnType -> type");
           $$ = $1;
       }
     | VOID
       {
-          log_production("returnType -> VOID");
-          AST *t = ast_new(NODE_TYPE, "void", @1.first_line);
-          $$ = t;
+          log_production(ctx, "returnType -> VOID");
+          $$ = INTERN_VOID;
       }
 ;
 
 %%
 
-static void log_production(const char *rule) {
-    if (derivation_file && rule) {
-        fprintf(derivation_file, "%s\n", rule);
-        fflush(derivation_file);
+/* productions held back in ARTIFACT_BUFFER mode until derivation_log_flush */
+static void log_production(struct CompilerContext *ctx, const char *rule) {
+    DerivationLog *log = &ctx->derivation;
+    if (!rule || log->mode == ARTIFACT_OFF) return;
+    if (log->mode == ARTIFACT_STREAM) {
+        if (log->file) {
+            fputs(rule, log->file);
+            fputc('\n', log->file);
+        }
+        return;
+    }
+    size_t len = strlen(rule);
+    if (log->length + len + 1 > log->capacity) {
+        size_t capacity = log->capacity ? log->capacity : 65536;
+        while (capacity < log->length + len + 1) capacity *= 2;
+        char *grown = (char*)realloc(log->buffer, capacity);
+        if (!grown) return;
+        log->buffer = grown;
+        log->capacity = capacity;
     }
+    memcpy(log->buffer + log->length, rule, len);
+    log->length += len;
+    log->buffer[log->length++] = '\n';
+}
+
+/* write out and release anything buffered by log_production */
+void derivation_log_flush(DerivationLog *log) {
+    if (log->file && log->length > 0)
+        fwrite(log->buffer, 1, log->length, log->file);
+    free(log->buffer);
+    log->buffer = NULL;
+    log->length = log->capacity = 0;
 }
 
-void yyerror(const char *s) {
-    fprintf(stderr, "Syntax error at line %d: %s\n", current_line, s);
+void yyerror(YYLTYPE *loc, yyscan_t scanner, struct CompilerContext *ctx, const char *s) {
+    (void)loc;
+    (void)scanner;
+    fprintf(stderr, "Syntax error at line %d: %s\n", ctx->scan.current_line, s);
 }
@@ -0,0 +1,309 @@
+#include <stdlib.h>
+#include "peephole.h"
+
+#define STORE_WINDOW 32            /* instructions scanned for an overwriting store */
+
+typedef struct {
+    X86Code *code;
+    unsigned char *dead;           /* per instruction, removed at the end of a sweep */
+    int *uses;                     /* per virtual register: operand occurrences */
+    int *first, *last;             /* per virtual register: first/last instruction using it */
+} Peep;
+
+typedef int (*PeepRule)(Peep *p, int i);
+
+/* what the rules may assume about an opcode */
+enum {
+    OP_MOVE    = 1,                /* copies src to dst */
+    OP_PURE    = 2,                /* only effect is writing dst */
+    OP_IMM_SRC = 4,                /* src may be an immediate */
+    OP_MEM_SRC = 8                 /* src may be memory */
+};
+
+static const unsigned char OP_INFO[X86_OP_COUNT] = {
+    [X86_MOV]      = OP_MOVE | OP_PURE | OP_IMM_SRC | OP_MEM_SRC,
+    [X86_MOVZX]    = OP_PURE,
+    [X86_ADD]      = OP_PURE | OP_IMM_SRC | OP_MEM_SRC,
+    [X86_SUB]      = OP_PURE | OP_IMM_SRC | OP_MEM_SRC,
+    [X86_AND]      = OP_PURE | OP_IMM_SRC | OP_MEM_SRC,
+    [X86_OR]       = OP_PURE | OP_IMM_SRC | OP_MEM_SRC,
+    [X86_XOR]      = OP_PURE | OP_IMM_SRC | OP_MEM_SRC,
+    [X86_NEG]      = OP_PURE,
+    [X86_NOT]      = OP_PURE,
+    [X86_SHL]      = OP_PURE,
+    [X86_SAR]      = OP_PURE,
+    [X86_SHR]      = OP_PURE,
+    [X86_IMUL]     = OP_PURE | OP_IMM_SRC | OP_MEM_SRC,
+    [X86_CMP]      = OP_IMM_SRC | OP_MEM_SRC,
+    [X86_MOVSD]    = OP_MOVE | OP_PURE | OP_MEM_SRC,
+    [X86_ADDSD]    = OP_PURE | OP_MEM_SRC,
+    [X86_SUBSD]    = OP_PURE | OP_MEM_SRC,
+    [X86_MULSD]    = OP_PURE | OP_MEM_SRC,
+    [X86_DIVSD]    = OP_PURE | OP_MEM_SRC,
+    [X86_UCOMISD]  = OP_MEM_SRC,
+    [X86_CVTSI2SD] = OP_PURE | OP_MEM_SRC,
+    [X86_XORPD]    = OP_PURE,
+};
+
+static int has(X86Op op, int flag) {
+    return (OP_INFO[op] & flag) != 0;
+}
+
+static int vreg_index(X86Operand opd) {
+    return x86_is_vreg(opd) ? opd.reg - X86_VREG_BASE : -1;
+}
+
+static int same_operand(X86Operand a, X86Operand b) {
+    if (a.kind != b.kind) return 0;
+    switch (a.kind) {
+        case X86_OPD_REG: return a.reg == b.reg;
+        case X86_OPD_IMM: return a.name == b.name && (a.name || a.value == b.value);
+        case X86_OPD_MEM: return a.name == b.name && a.size == b.size && (a.name || (a.reg == b.reg && a.value == b.value));
+        case X86_OPD_LABEL: return a.name == b.name;
+        default: return 1;
+    }
+}
+
+static int is_plain_imm(X86Operand opd) {
+    return opd.kind == X86_OPD_IMM && !opd.name;
+}
+
+static void note(Peep *p, X86Operand opd, int pos, int delta) {
+    int v = vreg_index(opd);
+    if (v < 0) return;
+    p->uses[v] += delta;
+    if (delta > 0) {
+        if (pos < p->first[v]) p->first[v] = pos;
+        if (pos > p->last[v]) p->last[v] = pos;
+    }
+}
+
+static void set_operand(Peep *p, int pos, X86Operand *slot, X86Operand opd) {
+    note(p, *slot, pos, -1);
+    note(p, opd, pos, 1);
+    *slot = opd;
+}
+
+static void kill(Peep *p, int i) {
+    p->dead[i] = 1;
+    note(p, p->code->insns[i].dst, i, -1);
+    note(p, p->code->insns[i].src, i, -1);
+}
+
+static int next_live(const Peep *p, int i) {
+    for (i++; i < p->code->count; i++)
+        if (!p->dead[i]) return i;
+    return -1;
+}
+
+static void collect_stats(Peep *p) {
+    for (int v = 0; v < p->code->vregCount; v++) {
+        p->uses[v] = 0;
+        p->first[v] = p->code->count;
+        p->last[v] = -1;
+    }
+    for (int i = 0; i < p->code->count; i++) {
+        note(p, p->code->insns[i].dst, i, 1);
+        note(p, p->code->insns[i].src, i, 1);
+    }
+}
+
+/* mov v, a ; op v, b  =>  mov v, (a op b) */
+static int fold_constant(Peep *p, int i) {
+    X86Insn *a = &p->code->insns[i];
+    int j = next_live(p, i);
+    if (a->op != X86_MOV || vreg_index(a->dst) < 0 || !is_plain_imm(a->src) || j < 0) return 0;
+    X86Insn *b = &p->code->insns[j];
+    if (!same_operand(b->dst, a->dst)) return 0;
+    unsigned int x = (unsigned int)a->src.value, y = (unsigned int)b->src.value;
+    if (b->op == X86_NEG) x = 0u - x;
+    else if (b->op == X86_NOT) x = ~x;
+    else if (!is_plain_imm(b->src)) return 0;
+    else if (b->op == X86_ADD) x += y;
+    else if (b->op == X86_SUB) x -= y;
+    else if (b->op == X86_AND) x &= y;
+    else if (b->op == X86_OR) x |= y;
+    else if (b->op == X86_XOR) x ^= y;
+    else if (b->op == X86_IMUL) x *= y;
+    else if (b->op == X86_SHL) x <<= y & 31;
+    else if (b->op == X86_SHR) x >>= y & 31;
+    else if (b->op == X86_SAR) x = (unsigned int)((int)x >> (y & 31));
+    else return 0;
+    a->src.value = (int)x;
+    kill(p, j);
+    return 1;
+}
+
+/* mov EAX, l ; push r ; mul [ESP] ; add ESP, 4 ; mov l, EAX  =>  imul l, r.
+   Only the low 32 bits of the product are kept, which mul and imul agree on. */
+static int mul_to_imul(Peep *p, int i) {
+    X86Insn *in = p->code->insns;
+    int idx[5] = { i };
+    for (int k = 1; k < 5; k++)
+        if ((idx[k] = next_live(p, idx[k - 1])) < 0) return 0;
+    X86Insn *load = &in[idx[0]], *push = &in[idx[1]], *mul = &in[idx[2]], *pop = &in[idx[3]], *store = &in[idx[4]];
+    X86Operand eax = x86_reg(X86_EAX), top = x86_mem(X86_ESP, 0), esp = x86_reg(X86_ESP);
+    if (load->op != X86_MOV || !same_operand(load->dst, eax) || load->src.kind != X86_OPD_REG) return 0;
+    if (push->op != X86_PUSH || mul->op != X86_MUL || !same_operand(mul->dst, top)) return 0;
+    if (pop->op != X86_ADD || !same_operand(pop->dst, esp) || !same_operand(pop->src, x86_imm(4))) return 0;
+    if (store->op != X86_MOV || !same_operand(store->dst, load->src) || !same_operand(store->src, eax)) return 0;
+    X86Operand l = load->src, r = push->dst;
+    for (int k = 1; k < 5; k++) kill(p, idx[k]);
+    load->op = X86_IMUL;
+    load->comment = NULL;
+    set_operand(p, i, &load->dst, l);
+    set_operand(p, i, &load->src, r);
+    return 1;
+}
+
+/* mov v, x ; op y, v  =>  op y, x  when that is v's only use and x is an
+   immediate or memory operand the instruction can take directly */
+static int fold_operand(Peep *p, int i) {
+    X86Insn *a = &p->code->insns[i];
+    int v = vreg_index(a->dst);
+    int j = next_live(p, i);
+    if (!has(a->op, OP_MOVE) || v < 0 || p->uses[v] != 2 || j < 0) return 0;
+    int need = a->src.kind == X86_OPD_IMM ? OP_IMM_SRC : a->src.kind == X86_OPD_MEM ? OP_MEM_SRC : 0;
+    if (!need) return 0;
+    X86Insn *b = &p->code->insns[j];
+    if (a->op == X86_MOV && b->op == X86_PUSH && same_operand(b->dst, a->dst)) {
+        set_operand(p, j, &b->dst, a->src);
+        if (!b->comment) b->comment = a->comment;
+        kill(p, i);
+        return 1;
+    }
+    if (!has(b->op, need)) return 0;
+    if (!same_operand(b->src, a->dst) || same_operand(b->dst, a->dst)) return 0;
+    if (a->src.kind == X86_OPD_MEM && b->dst.kind == X86_OPD_MEM) return 0;
+    set_operand(p, j, &b->src, a->src);
+    if (!b->comment) b->comment = a->comment;      /* keep naming the variable */
+    kill(p, i);
+    return 1;
+}
+
+/* mov [m], r ; mov s, [m]  =>  mov [m], r ; mov s, r */
+static int forward_store(Peep *p, int i) {
+    X86Insn *a = &p->code->insns[i];
+    int j = next_live(p, i);
+    if (!has(a->op, OP_MOVE) || a->dst.kind != X86_OPD_MEM || a->src.kind == X86_OPD_MEM || j < 0) return 0;
+    X86Insn *b = &p->code->insns[j];
+    if (b->op != a->op || b->dst.kind != X86_OPD_REG || !same_operand(b->src, a->dst)) return 0;
+    if (same_operand(b->dst, a->src)) kill(p, j);
+    else set_operand(p, j, &b->src, a->src);
+    return 1;
+}
+
+/* mov x, x  and the second of  mov x, y ; mov y, x */
+static int drop_move(Peep *p, int i) {
+    X86Insn *a = &p->code->insns[i];
+    if (!has(a->op, OP_MOVE)) return 0;
+    if (same_operand(a->dst, a->src)) {
+        kill(p, i);
+        return 1;
+    }
+    int j = next_live(p, i);
+    if (j < 0) return 0;
+    X86Insn *b = &p->code->insns[j];
+    if (b->op != a->op || !same_operand(b->dst, a->src) || !same_operand(b->src, a->dst)) return 0;
+    kill(p, j);
+    return 1;
+}
+
+/* a store to a variable or spill slot that is overwritten before anything
+   reads it; control flow and calls end the search */
+static int dead_store(Peep *p, int i) {
+    X86Insn *a = &p->code->insns[i];
+    X86Operand m = a->dst;
+    if (!has(a->op, OP_MOVE) || m.kind != X86_OPD_MEM || (!m.name && m.reg == X86_ESP)) return 0;
+    int j = i;
+    for (int scanned = 0; scanned < STORE_WINDOW && (j = next_live(p, j)) >= 0; scanned++) {
+        X86Insn *b = &p->code->insns[j];
+        switch (b->op) {
+            case X86_LABEL: case X86_JMP: case X86_JCC: case X86_CALL: case X86_RET:
+                return 0;
+            default:
+                break;
+        }
+        if (same_operand(b->src, m)) return 0;
+        if (same_operand(b->dst, m)) {
+            if (b->op != a->op) return 0;
+            kill(p, i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* mov w, v  where v dies and w is born: w becomes v */
+static int coalesce(Peep *p, int i) {
+    X86Insn *a = &p->code->insns[i];
+    int w = vreg_index(a->dst), v = vreg_index(a->src);
+    if (!has(a->op, OP_MOVE) || w < 0 || v < 0 || w == v) return 0;
+    if (p->last[v] != i || p->first[w] != i) return 0;
+    int end = p->last[w];
+    kill(p, i);
+    for (int j = i + 1; j <= end; j++) {
+        if (p->dead[j]) continue;
+        X86Insn *b = &p->code->insns[j];
+        if (vreg_index(b->dst) == w) set_operand(p, j, &b->dst, a->src);
+        if (vreg_index(b->src) == w) set_operand(p, j, &b->src, a->src);
+    }
+    return 1;
+}
+
+/* an instruction whose only effect is a virtual register nothing reads later */
+static int dead_def(Peep *p, int i) {
+    X86Insn *a = &p->code->insns[i];
+    int v = vreg_index(a->dst);
+    if (v < 0 || p->last[v] != i || !has(a->op, OP_PURE)) return 0;
+    kill(p, i);
+    return 1;
+}
+
+/* tried in order at every instruction */
+static const PeepRule RULES[] = {
+    fold_constant,
+    mul_to_imul,
+    fold_operand,
+    forward_store,
+    drop_move,
+    dead_store,
+    coalesce,
+    dead_def,
+};
+
+#define RULE_COUNT ((int)(sizeof(RULES) / sizeof(RULES[0])))
+
+int peephole_run(X86Code *code) {
+    int n = code->vregCount ? code->vregCount : 1;
+    Peep p = { code, NULL, NULL, NULL, NULL };
+    int removed = -1;
+    p.dead = (unsigned char*)malloc((size_t)(code->count ? code->count : 1));
+    p.uses = (int*)malloc((size_t)n * sizeof(int));
+    p.first = (int*)malloc((size_t)n * sizeof(int));
+    p.last = (int*)malloc((size_t)n * sizeof(int));
+    if (!p.dead || !p.uses || !p.first || !p.last) goto done;
+
+    removed = 0;
+    for (int changed = 1; changed; ) {
+        changed = 0;
+        collect_stats(&p);
+        for (int i = 0; i < code->count; i++) p.dead[i] = 0;
+        for (int i = 0; i < code->count; i++) {
+            for (int r = 0; r < RULE_COUNT && !p.dead[i]; r++)
+                if (RULES[r](&p, i)) changed = 1;
+        }
+        int kept = 0;
+        for (int i = 0; i < code->count; i++)
+            if (!p.dead[i]) code->insns[kept++] = code->insns[i];
+        removed += code->count - kept;
+        code->count = kept;
+    }
+
+done:
+    free(p.last);
+    free(p.first);
+    free(p.uses);
+    free(p.dead);
+    return removed;
+}
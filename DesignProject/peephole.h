@@ -0,0 +1,18 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "x86_code.h"
+
+/* table-driven peephole pass over one function's instruction list. Folds
+   immediates and single-use loads into the instruction that consumes them,
+   forwards a store to the reload that follows it, drops self and reversed
+   moves and overwritten stores, and turns the push/mul [ESP] multiply
+   sequence into imul.
+
+   Runs before register allocation, where it also merges copies between
+   virtual registers, and is safe to run again on allocated code. Rewrites
+   code in place; returns the number of instructions removed, or -1 if it
+   runs out of memory. */
+int peephole_run(X86Code *code);
+
+#endif
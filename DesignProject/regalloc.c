@@ -0,0 +1,367 @@
+#include <stdlib.h>
+#include "regalloc.h"
+
+#define WORD_SIZE 4
+
+/* allocation order: caller-saved registers first, they cost no save/restore */
+static const int POOL[REGALLOC_POOL_SIZE] = { X86_ECX, X86_EDX, X86_EBX, X86_ESI, X86_EDI };
+/* every XMM register is caller-saved; XMM7 is kept back like EAX */
+static const int XMM_POOL[] = { X86_XMM0, X86_XMM1, X86_XMM2, X86_XMM3, X86_XMM4, X86_XMM5, X86_XMM6 };
+#define XMM_POOL_SIZE ((int)(sizeof(XMM_POOL) / sizeof(XMM_POOL[0])))
+#define XMM_SCRATCH X86_XMM7
+#define XMM_REGS (0xffu << X86_XMM0)
+
+#define REG_BIT(r) (1u << (r))
+
+/* positions are in half-steps: instruction p reads at 2p and writes at 2p+1 */
+typedef struct {
+    int start, end;
+} Range;
+
+typedef struct {
+    Range *ranges;                 /* sorted, disjoint */
+    int count, capacity;
+} Busy;
+
+typedef struct {
+    int vreg;
+    int start, end;                /* half-step positions, -1 if never used */
+    int xmm;                       /* holds a double: XMM register or 8-byte slot */
+    int reg;                       /* assigned machine register, -1 if spilled */
+    int slot;                      /* spill slot, -1 if in a register */
+    int disp;                      /* spill slot's EBP displacement */
+} Interval;
+
+static int busy_add(Busy *b, int start, int end) {
+    if (b->count == b->capacity) {
+        int capacity = b->capacity ? b->capacity * 2 : 16;
+        Range *grown = (Range*)realloc(b->ranges, (size_t)capacity * sizeof(Range));
+        if (!grown) return -1;
+        b->ranges = grown;
+        b->capacity = capacity;
+    }
+    b->ranges[b->count].start = start;
+    b->ranges[b->count].end = end;
+    b->count++;
+    return 0;
+}
+
+static int range_cmp(const void *a, const void *b) {
+    return ((const Range*)a)->start - ((const Range*)b)->start;
+}
+
+static void busy_normalize(Busy *b) {
+    if (b->count == 0) return;
+    qsort(b->ranges, (size_t)b->count, sizeof(Range), range_cmp);
+    int n = 0;
+    for (int i = 1; i < b->count; i++) {
+        if (b->ranges[i].start <= b->ranges[n].end + 1) {
+            if (b->ranges[i].end > b->ranges[n].end) b->ranges[n].end = b->ranges[i].end;
+        } else {
+            b->ranges[++n] = b->ranges[i];
+        }
+    }
+    b->count = n + 1;
+}
+
+static int busy_overlaps(const Busy *b, int start, int end) {
+    int lo = 0, hi = b->count;
+    while (lo < hi) {                  /* first range ending at or after start */
+        int mid = (lo + hi) / 2;
+        if (b->ranges[mid].end < start) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < b->count && b->ranges[lo].start <= end;
+}
+
+static int machine_reg(X86Operand opd) {
+    if (opd.kind != X86_OPD_REG || opd.reg >= X86_VREG_BASE) return -1;
+    return opd.reg == X86_AL ? X86_EAX : opd.reg;
+}
+
+/* xorpd x, x zeroes x; any other xorpd also reads its destination */
+static int zeroing_xorpd(const X86Insn *in) {
+    return in->op == X86_XORPD && in->dst.kind == in->src.kind &&
+           in->dst.reg == in->src.reg && in->dst.value == in->src.value;
+}
+
+/* machine registers an instruction reads and writes, implicit ones included */
+static void machine_access(const X86Insn *in, unsigned int *reads, unsigned int *writes) {
+    unsigned int r = 0, w = 0;
+    switch (in->op) {
+        case X86_CALL: w |= REG_BIT(X86_EAX) | REG_BIT(X86_ECX) | REG_BIT(X86_EDX) | XMM_REGS; break;
+        case X86_MUL:
+        case X86_IMUL_WIDE: r |= REG_BIT(X86_EAX); w |= REG_BIT(X86_EAX) | REG_BIT(X86_EDX); break;
+        case X86_IDIV: r |= REG_BIT(X86_EAX) | REG_BIT(X86_EDX); w |= REG_BIT(X86_EAX) | REG_BIT(X86_EDX); break;
+        case X86_CDQ:  r |= REG_BIT(X86_EAX); w |= REG_BIT(X86_EDX); break;
+        default: break;
+    }
+    int dst = machine_reg(in->dst), src = machine_reg(in->src);
+    if (src >= 0) r |= REG_BIT(src);
+    if (dst >= 0 && zeroing_xorpd(in)) {
+        w |= REG_BIT(dst);
+    } else if (dst >= 0) {
+        switch (in->op) {
+            case X86_MOV: case X86_MOVZX: case X86_POP: case X86_SETCC:
+            case X86_MOVSD: case X86_CVTSI2SD:
+                w |= REG_BIT(dst);
+                break;
+            case X86_CMP: case X86_TEST: case X86_PUSH: case X86_UCOMISD: case X86_IMUL_WIDE:
+                r |= REG_BIT(dst);
+                break;
+            default:
+                r |= REG_BIT(dst);
+                w |= REG_BIT(dst);
+                break;
+        }
+    }
+    *reads = r;
+    *writes = w;
+}
+
+/* where each pool register holds a machine value the code relies on: from a
+   write to the reads that follow it, plus every clobber */
+static int collect_busy(const X86Code *code, Busy busy[X86_REG_COUNT]) {
+    int lastWrite[X86_REG_COUNT];
+    for (int r = 0; r < X86_REG_COUNT; r++) lastWrite[r] = -1;
+    for (int p = 0; p < code->count; p++) {
+        unsigned int reads, writes;
+        machine_access(&code->insns[p], &reads, &writes);
+        for (int r = 0; r < X86_REG_COUNT; r++) {
+            if (reads & REG_BIT(r)) {
+                int from = lastWrite[r] >= 0 ? 2 * lastWrite[r] + 1 : 2 * p;
+                if (busy_add(&busy[r], from, 2 * p) != 0) return -1;
+            }
+            if (writes & REG_BIT(r)) {
+                if (busy_add(&busy[r], 2 * p + 1, 2 * p + 1) != 0) return -1;
+                lastWrite[r] = p;
+            }
+        }
+    }
+    for (int r = 0; r < X86_REG_COUNT; r++) busy_normalize(&busy[r]);
+    return 0;
+}
+
+static void extend(Interval *iv, X86Operand opd, int p) {
+    if (!x86_is_vreg(opd)) return;
+    Interval *v = &iv[opd.reg - X86_VREG_BASE];
+    if (v->start < 0) v->start = 2 * p;
+    v->end = 2 * p + 1;
+    v->xmm = x86_is_xmm(opd);
+}
+
+static int start_cmp(const void *a, const void *b) {
+    const Interval *x = *(Interval *const *)a, *y = *(Interval *const *)b;
+    return x->start != y->start ? x->start - y->start : x->vreg - y->vreg;
+}
+
+/* interval graph colouring in start order reuses slots as soon as they die;
+   only intervals of one register class share slots */
+static int assign_slots(Interval **spilled, int count, int xmm) {
+    int *slotEnd = (int*)malloc((size_t)(count ? count : 1) * sizeof(int));
+    if (!slotEnd) return -1;
+    int slots = 0;
+    for (int i = 0; i < count; i++) {
+        if (spilled[i]->xmm != xmm) continue;
+        int s = 0;
+        while (s < slots && slotEnd[s] >= spilled[i]->start) s++;
+        if (s == slots) slots++;
+        slotEnd[s] = spilled[i]->end;
+        spilled[i]->slot = s;
+    }
+    free(slotEnd);
+    return slots;
+}
+
+static X86Operand rewrite(X86Operand opd, const Interval *iv, int frameBase) {
+    if (x86_is_vreg(opd)) {
+        const Interval *v = &iv[opd.reg - X86_VREG_BASE];
+        if (v->reg >= 0) return v->xmm ? x86_xmm(v->reg) : x86_reg(v->reg);
+        return v->xmm ? x86_mem_qword(X86_EBP, -(frameBase + v->disp)) : x86_mem(X86_EBP, -(frameBase + v->disp));
+    }
+    return opd;
+}
+
+static int two_operand(X86Op op) {
+    switch (op) {
+        case X86_MOV: case X86_ADD: case X86_SUB: case X86_AND: case X86_OR:
+        case X86_XOR: case X86_CMP: case X86_TEST:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int emit_copy(X86Code *out, const X86Insn *in) {
+    X86Insn *e = x86_emit(out, in->op, in->dst, in->src);
+    if (!e) return -1;
+    e->cond = in->cond;
+    e->comment = in->comment;
+    return 0;
+}
+
+/* SSE arithmetic, compares and conversions need a register destination */
+static int sse_register_dst(X86Op op) {
+    switch (op) {
+        case X86_ADDSD: case X86_SUBSD: case X86_MULSD: case X86_DIVSD:
+        case X86_UCOMISD: case X86_CVTSI2SD: case X86_XORPD:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* spilled doubles go through XMM7 the way spilled integers go through EAX */
+static int emit_legal_sse(X86Code *out, X86Insn in) {
+    X86Operand scratch = x86_xmm(XMM_SCRATCH);
+    if (in.op == X86_MOVSD) {
+        if (!x86_emit(out, X86_MOVSD, scratch, in.src)) return -1;
+        in.src = scratch;
+        return emit_copy(out, &in);
+    }
+    if (in.op == X86_XORPD && !zeroing_xorpd(&in) && in.src.kind == X86_OPD_MEM) {
+        /* xorpd only takes a 16-byte aligned memory operand, which frame
+           slots are not, so a spilled source goes through a register */
+        if (in.dst.kind != X86_OPD_MEM) {
+            if (!x86_emit(out, X86_MOVSD, scratch, in.src)) return -1;
+            in.src = scratch;
+            return emit_copy(out, &in);
+        }
+        /* both spilled: XMM0 is borrowed for the source and put back */
+        X86Operand esp = x86_reg(X86_ESP), top = x86_mem_qword(X86_ESP, 0), borrowed = x86_xmm(X86_XMM0);
+        if (!x86_emit(out, X86_SUB, esp, x86_imm(8)) || !x86_emit(out, X86_MOVSD, top, borrowed) ||
+            !x86_emit(out, X86_MOVSD, scratch, in.dst) || !x86_emit(out, X86_MOVSD, borrowed, in.src) ||
+            !x86_emit(out, X86_XORPD, scratch, borrowed) || !x86_emit(out, X86_MOVSD, borrowed, top) ||
+            !x86_emit(out, X86_ADD, esp, x86_imm(8)))
+            return -1;
+        return x86_emit(out, X86_MOVSD, in.dst, scratch) ? 0 : -1;
+    }
+    X86Operand slot = in.dst;
+    int zeroing = zeroing_xorpd(&in);
+    in.dst = scratch;
+    if (zeroing) in.src = scratch;
+    else if (in.op != X86_CVTSI2SD && !x86_emit(out, X86_MOVSD, scratch, slot)) return -1;
+    if (emit_copy(out, &in) != 0) return -1;
+    if (in.op == X86_UCOMISD) return 0;
+    return x86_emit(out, X86_MOVSD, slot, scratch) ? 0 : -1;
+}
+
+/* spilled operands become frame references; EAX stands in where x86 cannot
+   take a memory operand */
+static int emit_legal(X86Code *out, X86Insn in) {
+    if ((in.dst.kind == X86_OPD_MEM &&
+         (sse_register_dst(in.op) || (in.op == X86_MOVSD && in.src.kind == X86_OPD_MEM))) ||
+        (in.op == X86_XORPD && in.src.kind == X86_OPD_MEM))
+        return emit_legal_sse(out, in);
+    if (two_operand(in.op) && in.dst.kind == X86_OPD_MEM && in.src.kind == X86_OPD_MEM) {
+        if (!x86_emit(out, X86_MOV, x86_reg(X86_EAX), in.src)) return -1;
+        in.src = x86_reg(X86_EAX);
+    } else if ((in.op == X86_MOVZX || in.op == X86_IMUL) && in.dst.kind == X86_OPD_MEM) {
+        /* both need a register destination */
+        X86Operand slot = in.dst;
+        in.dst = x86_reg(X86_EAX);
+        if (in.op == X86_IMUL && !x86_emit(out, X86_MOV, in.dst, slot)) return -1;
+        if (emit_copy(out, &in) != 0) return -1;
+        return x86_emit(out, X86_MOV, slot, x86_reg(X86_EAX)) ? 0 : -1;
+    }
+    return emit_copy(out, &in);
+}
+
+int regalloc_run(X86Code *code, int frameBase, unsigned int *usedRegs) {
+    int n = code->vregCount;
+    int spillBytes = -1;
+    *usedRegs = 0;
+    Busy busy[X86_REG_COUNT] = {{0}};
+    Interval *iv = (Interval*)malloc((size_t)(n ? n : 1) * sizeof(Interval));
+    Interval **order = (Interval**)malloc((size_t)(n ? n : 1) * sizeof(Interval*));
+    Interval **active = (Interval**)malloc((size_t)(n ? n : 1) * sizeof(Interval*));
+    X86Code out;
+    x86_code_init(&out);
+    if (!iv || !order || !active || collect_busy(code, busy) != 0) goto done;
+
+    for (int v = 0; v < n; v++) {
+        iv[v].vreg = v;
+        iv[v].start = iv[v].end = -1;
+        iv[v].xmm = 0;
+        iv[v].reg = iv[v].slot = -1;
+    }
+    for (int p = 0; p < code->count; p++) {
+        extend(iv, code->insns[p].dst, p);
+        extend(iv, code->insns[p].src, p);
+    }
+    int count = 0;
+    for (int v = 0; v < n; v++)
+        if (iv[v].start >= 0) order[count++] = &iv[v];
+    qsort(order, (size_t)count, sizeof(Interval*), start_cmp);
+
+    int activeCount = 0;
+    int spilledCount = 0;
+    for (int i = 0; i < count; i++) {
+        Interval *cur = order[i];
+        int held = 0;
+        int k = 0;
+        for (int a = 0; a < activeCount; a++) {
+            if (active[a]->end < cur->start) continue;      /* expired */
+            active[k++] = active[a];
+            held |= (int)REG_BIT(active[a]->reg);
+        }
+        activeCount = k;
+
+        const int *pool = cur->xmm ? XMM_POOL : POOL;
+        int poolSize = cur->xmm ? XMM_POOL_SIZE : REGALLOC_POOL_SIZE;
+        for (int j = 0; j < poolSize && cur->reg < 0; j++) {
+            int r = pool[j];
+            if (!(held & (int)REG_BIT(r)) && !busy_overlaps(&busy[r], cur->start, cur->end))
+                cur->reg = r;
+        }
+        if (cur->reg < 0) {
+            /* spill whichever live value is needed furthest away */
+            int victim = -1;
+            for (int a = 0; a < activeCount; a++) {
+                if (active[a]->xmm != cur->xmm) continue;
+                if (busy_overlaps(&busy[active[a]->reg], cur->start, cur->end)) continue;
+                if (victim < 0 || active[a]->end > active[victim]->end) victim = a;
+            }
+            if (victim >= 0 && active[victim]->end > cur->end) {
+                cur->reg = active[victim]->reg;
+                active[victim]->reg = -1;
+                order[spilledCount++] = active[victim];   /* order[0..i) is done with */
+                active[victim] = active[--activeCount];
+            } else {
+                order[spilledCount++] = cur;
+                continue;
+            }
+        }
+        *usedRegs |= REG_BIT(cur->reg);
+        active[activeCount++] = cur;
+    }
+
+    qsort(order, (size_t)spilledCount, sizeof(Interval*), start_cmp);
+    int slots = assign_slots(order, spilledCount, 0);
+    int xmmSlots = assign_slots(order, spilledCount, 1);
+    if (slots < 0 || xmmSlots < 0) goto done;
+    /* word slots first, then 8-byte slots for doubles */
+    for (int i = 0; i < spilledCount; i++) {
+        Interval *v = order[i];
+        v->disp = v->xmm ? WORD_SIZE * slots + 8 * (v->slot + 1) : WORD_SIZE * (v->slot + 1);
+    }
+
+    for (int p = 0; p < code->count; p++) {
+        X86Insn in = code->insns[p];
+        in.dst = rewrite(in.dst, iv, frameBase);
+        in.src = rewrite(in.src, iv, frameBase);
+        if (emit_legal(&out, in) != 0) goto done;
+    }
+    x86_code_free(code);
+    *code = out;
+    x86_code_init(&out);
+    spillBytes = slots * WORD_SIZE + xmmSlots * 8;
+
+done:
+    x86_code_free(&out);
+    for (int r = 0; r < X86_REG_COUNT; r++) free(busy[r].ranges);
+    free(active);
+    free(order);
+    free(iv);
+    return spillBytes;
+}
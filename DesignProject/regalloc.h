@@ -0,0 +1,20 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "x86_code.h"
+
+/* linear-scan register allocation over one function's instruction list.
+   Virtual registers get EBX, ECX, EDX, ESI or EDI; EAX is kept free for
+   the fixed mul/idiv/setcc/call sequences and for reloading spilled
+   operands. Double-precision values get XMM0-XMM6 the same way, with XMM7
+   as their scratch register. Values that do not fit are spilled to frame
+   slots below the frameBase bytes the function already reserves.
+
+   Rewrites code in place and returns the spill bytes added to the frame,
+   or -1 if it runs out of memory. *usedRegs receives a bitmask (1 << X86Reg)
+   of the machine registers handed out. */
+#define REGALLOC_POOL_SIZE 5
+
+int regalloc_run(X86Code *code, int frameBase, unsigned int *usedRegs);
+
+#endif
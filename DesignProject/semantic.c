@@ -4,25 +4,31 @@
 #include <stdarg.h>
 #include "ast.h"
 #include "symbol_table.h"
+#include "semantic.h"
 
-/* globals */
-SymTable *globalTable = NULL;
-FILE *errFile = NULL;
+void semantic_init(SemanticContext *sem, InternPool *names, TypeTable *types, FILE *errFile) {
+    memset(sem, 0, sizeof(*sem));
+    sem->names = names;
+    sem->types = types;
+    sem->errFile = errFile;
+}
 
-/* --- simple structure to track duplicates --- */
-#define MAX_ERRORS 1000
-static char *errorMsgs[MAX_ERRORS];
-static int errorCount = 0;
+void semantic_free(SemanticContext *sem) {
+    for (int i = 0; i < sem->errorCount; i++) free(sem->errorMsgs[i]);
+    sem->errorCount = 0;
+    symtable_free_all(sem->globalTable);
+    sem->globalTable = NULL;
+}
 
 /* error handler */
-static int already_reported(const char *msg) {
-    for (int i = 0; i < errorCount; i++) {
-        if (strcmp(errorMsgs[i], msg) == 0) return 1;
+static int already_reported(SemanticContext *sem, const char *msg) {
+    for (int i = 0; i < sem->errorCount; i++) {
+        if (strcmp(sem->errorMsgs[i], msg) == 0) return 1;
     }
     return 0;
 }
 
-static void sem_error(int lineno, const char *fmt, ...) {
+static void sem_error(SemanticContext *sem, int lineno, const char *fmt, ...) {
     char buffer[1024];
     va_list ap;
     va_start(ap, fmt);
@@ -32,100 +38,111 @@ static void sem_error(int lineno, const char *fmt, ...) {
     char fullMsg[1200];
     snprintf(fullMsg, sizeof(fullMsg), "Semantic Error [line %d]: %s", lineno, buffer);
 
-    if (!already_reported(fullMsg)) {
-        if (errorCount < MAX_ERRORS)
-            errorMsgs[errorCount++] = strdup(fullMsg);
+    if (!already_reported(sem, fullMsg)) {
+        if (sem->errorCount < MAX_ERRORS)
+            sem->errorMsgs[sem->errorCount++] = strdup(fullMsg);
 
-        if (errFile)
-            fprintf(errFile, "%s\n", fullMsg);
+        if (sem->errFile)
+            fprintf(sem->errFile, "%s\n", fullMsg);
         else
             fprintf(stdout, "%s\n", fullMsg);
     }
 }
 
 /* pass A - build symbol table */
-static void semantic_passA_build(SymTable *curScope, AST *node);
+static void semantic_passA_build(SemanticContext *sem, SymTable *curScope, AST *node);
 
 static AST *get_class_body(AST *classNode) {
     if (!classNode) return NULL;
-    AST *first = classNode->child;
-    if (first && first->kind == NODE_CLASS_INHERIT_LIST) return first->sibling;
+    AST *first = ast_child(classNode);
+    if (first && first->kind == NODE_CLASS_INHERIT_LIST) return ast_sibling(first);
     return first;
 }
 
-static int is_numeric_type(const char *typeName) {
-    return typeName && (strcmp(typeName, "int") == 0 || strcmp(typeName, "float") == 0);
+static const char *type_text(const SemanticContext *sem, TypeId type) {
+    return type_name(sem->types, type);
 }
 
-static void passA_walk_list(SymTable *curScope, AST *list) {
-    for (AST *p = list; p; p = p->sibling) {
-        semantic_passA_build(curScope, p);
+/* records the type a declaration names on the node */
+static TypeId declared_type(SemanticContext *sem, AST *decl) {
+    decl->typeId = type_for_name(sem->types, decl->typeNameId);
+    return decl->typeId;
+}
+
+static void passA_walk_list(SemanticContext *sem, SymTable *curScope, AST *list) {
+    for (AST *p = list; p; p = ast_sibling(p)) {
+        semantic_passA_build(sem, curScope, p);
     }
 }
 
-static void bind_function_params(Symbol *funcSym, AST *paramList) {
-    for (AST *p = paramList; p; p = p->sibling) {
-        symtable_add_param(funcSym, p->name,
-            p->typeName ? p->typeName : "<nil>", p->lineno);
+static void bind_function_params(SemanticContext *sem, SymTable *scope, Symbol *funcSym, AST *paramList) {
+    for (AST *p = paramList; p; p = ast_sibling(p)) {
+        symtable_add_param(scope, funcSym, p->nameId, declared_type(sem, p), p->lineno);
     }
 }
 
-static void semantic_passA_build(SymTable *curScope, AST *node) {
+static void semantic_passA_build(SemanticContext *sem, SymTable *curScope, AST *node) {
     if (!node) return;
 
     switch (node->kind) {
         case NODE_CLASS_DECL: {
-            if (symtable_insert(curScope, node->name,
-                                node->name,
+            if (symtable_insert(curScope, node->nameId,
+                                type_for_name(sem->types, node->nameId),
                                 SYM_CLASS, node->lineno)) {
-                sem_error(node->lineno,
+                sem_error(sem, node->lineno,
                           "Class '%s' redeclared in scope '%s'",
-                          node->name,
+                          ast_name(node),
                           curScope->scopeName ? curScope->scopeName : "<global>");
+                /* later passes use the scope of the first declaration */
+                node->scope = symtable_find_scope(sem->globalTable, node->nameId, curScope);
             } else {
-                SymTable *classScope = symtable_create(node->name, curScope);
+                SymTable *classScope = symtable_create(sem->names, sem->types, node->nameId, curScope);
                 symtable_register_scope(classScope);
+                node->scope = classScope;
                 AST *body = get_class_body(node);
-                if (body) passA_walk_list(classScope, body);
+                if (body) passA_walk_list(sem, classScope, body);
             }
             break;
         }
         case NODE_FUNC_DECL: {
-            if (symtable_insert(curScope, node->name,
-                                node->typeName ? node->typeName : "<nil>",
+            if (symtable_insert(curScope, node->nameId,
+                                declared_type(sem, node),
                                 SYM_FUNC, node->lineno)) {
-                sem_error(node->lineno,
+                sem_error(sem, node->lineno,
                           "Function '%s' redeclared in scope '%s'",
-                          node->name,
+                          ast_name(node),
                           curScope->scopeName ? curScope->scopeName : "<global>");
+                node->scope = symtable_find_scope(sem->globalTable, node->nameId, curScope);
             } else {
-                SymTable *fnScope = symtable_create(node->name, curScope);
+                SymTable *fnScope = symtable_create(sem->names, sem->types, node->nameId, curScope);
                 symtable_register_scope(fnScope);
-
-                AST *param = node->child;
-                Symbol *funcSym = symtable_lookup(curScope, node->name);
-                bind_function_params(funcSym, param);
-
-                for (AST *pp = param; pp; pp = pp->sibling) {
-                    if (symtable_insert(fnScope, pp->name,
-                                        pp->typeName ? pp->typeName : "<nil>",
-                                        SYM_PARAM, pp->lineno)) {
-                        sem_error(pp->lineno,
+                node->scope = fnScope;
+
+                AST *param = ast_child(node);
+                Symbol *funcSym = symtable_lookup(curScope, node->nameId);
+                bind_function_params(sem, curScope, funcSym, param);
+
+                int index = 0;
+                for (AST *pp = param; pp; pp = ast_sibling(pp), index++) {
+                    if (symtable_insert_param(fnScope, pp->nameId,
+                                              declared_type(sem, pp),
+                                              index, pp->lineno)) {
+                        sem_error(sem, pp->lineno,
                                   "Parameter '%s' duplicated in function '%s'",
-                                  pp->name, node->name);
+                                  ast_name(pp), ast_name(node));
                     }
                 }
 
-                AST *body = node->extra;
-                if (body && body->child) {
-                    for (AST *st = body->child; st; st = st->sibling) {
+                AST *body = ast_extra(node);
+                if (body && ast_child(body)) {
+                    for (AST *st = ast_child(body); st; st = ast_sibling(st)) {
                         if (st->kind == NODE_VAR_DECL) {
-                            if (symtable_insert(fnScope, st->name,
-                                                st->typeName ? st->typeName : "<nil>",
+                            if (symtable_insert(fnScope, st->nameId,
+                                                declared_type(sem, st),
                                                 SYM_VAR, st->lineno)) {
-                                sem_error(st->lineno,
+                                sem_error(sem, st->lineno,
                                           "Local variable '%s' redeclared in function '%s'",
-                                          st->name, node->name);
+                                          ast_name(st), ast_name(node));
                             }
                         }
                     }
@@ -134,314 +151,318 @@ static void semantic_passA_build(SymTable *curScope, AST *node) {
             break;
         }
         case NODE_ATTRIBUTE: {
-            AST *var = node->child;
+            AST *var = ast_child(node);
             if (var) {
-                if (symtable_insert(curScope, var->name,
-                                    var->typeName ? var->typeName : "<nil>",
+                if (symtable_insert(curScope, var->nameId,
+                                    declared_type(sem, var),
                                     SYM_ATTR, var->lineno)) {
-                    sem_error(var->lineno,
+                    sem_error(sem, var->lineno,
                               "Attribute '%s' redeclared in scope '%s'",
-                              var->name,
+                              ast_name(var),
                               curScope->scopeName ? curScope->scopeName : "<global>");
                 }
             }
             break;
         }
         case NODE_VAR_DECL: {
-            if (symtable_insert(curScope, node->name,
-                                node->typeName ? node->typeName : "<nil>",
+            if (symtable_insert(curScope, node->nameId,
+                                declared_type(sem, node),
                                 SYM_VAR, node->lineno)) {
-                sem_error(node->lineno,
+                sem_error(sem, node->lineno,
                           "Variable '%s' redeclared in scope '%s'",
-                          node->name,
+                          ast_name(node),
                           curScope->scopeName ? curScope->scopeName : "<global>");
             }
             break;
         }
         default:
-            if (node->child)
-                passA_walk_list(curScope, node->child);
+            if (ast_child(node))
+                passA_walk_list(sem, curScope, ast_child(node));
             break;
     }
-
-    if (node->sibling)
-        semantic_passA_build(curScope, node->sibling);
 }
 
-void semantic_passA(AST *root) {
-    globalTable = symtable_create("global", NULL);
-    symtable_registry_reset(globalTable);
-    for (AST *p = root->child; p; p = p->sibling)
-        semantic_passA_build(globalTable, p);
+void semantic_passA(SemanticContext *sem, AST *root) {
+    sem->globalTable = symtable_create(sem->names, sem->types, INTERN_GLOBAL, NULL);
+    symtable_registry_reset(sem->globalTable);
+    for (AST *p = ast_child(root); p; p = ast_sibling(p))
+        semantic_passA_build(sem, sem->globalTable, p);
 }
 
 /* passB - semantic check */
 
-static const char *resolve_type_of_expr(SymTable *curScope, AST *expr);
+static TypeId resolve_type_of_expr(SemanticContext *sem, SymTable *curScope, AST *expr);
 
-static const char *resolve_type_of_expr(SymTable *curScope, AST *expr) {
-    if (!expr) return "<void>";
+static TypeId infer_expr_type(SemanticContext *sem, SymTable *curScope, AST *expr) {
 
     switch (expr->kind) {
-        case NODE_INT_LITERAL: return "int";
-        case NODE_FLOAT_LITERAL: return "float";
-        case NODE_STRING_LITERAL: return "string";
+        case NODE_INT_LITERAL: return TYPE_INT;
+        case NODE_FLOAT_LITERAL: return TYPE_FLOAT;
+        case NODE_STRING_LITERAL: return TYPE_STRING;
 
         case NODE_ID: {
-            Symbol *s = symtable_lookup(curScope, expr->name);
+            Symbol *s = expr->symbol ? expr->symbol : symtable_lookup(curScope, expr->nameId);
             if (!s) {
-                sem_error(expr->lineno,
+                sem_error(sem, expr->lineno,
                           "Identifier '%s' used before declaration",
-                          expr->name);
-                return "<error>";
+                          ast_name(expr));
+                return TYPE_ERROR;
             }
-            return s->typeName ? s->typeName : "<nil>";
+            expr->symbol = s;
+            return s->type;
         }
 
         case NODE_BINARY_OP: {
-            const char *lt = resolve_type_of_expr(curScope, expr->child);
-            const char *rt = resolve_type_of_expr(curScope,
-                                                  expr->child ? expr->child->sibling : NULL);
-
-            if (!expr->name) return "<error>";
-
-            /* arithmetic */
-            if (strcmp(expr->name, "+") == 0 ||
-                strcmp(expr->name, "-") == 0 ||
-                strcmp(expr->name, "*") == 0 ||
-                strcmp(expr->name, "/") == 0) {
-
-                int leftNum = (strcmp(lt, "int") == 0 || strcmp(lt, "float") == 0);
-                int rightNum = (strcmp(rt, "int") == 0 || strcmp(rt, "float") == 0);
-                if (leftNum && rightNum) {
-                    // if either is float, promote result to float
-                    if (strcmp(lt, "float") == 0 || strcmp(rt, "float") == 0)
-                        return "float";
-                    return "int";
-                } else {
-                    sem_error(expr->lineno,
+            TypeId lt = resolve_type_of_expr(sem, curScope, ast_child(expr));
+            TypeId rt = resolve_type_of_expr(sem, curScope,
+                                               ast_child(expr) ? ast_sibling(ast_child(expr)) : NULL);
+
+            switch (expr->op) {
+                /* arithmetic */
+                case OP_ADD:
+                case OP_SUB:
+                case OP_MUL:
+                case OP_DIV:
+                    if (type_is_numeric(lt) && type_is_numeric(rt)) {
+                        // if either is float, promote result to float
+                        if (lt == TYPE_FLOAT || rt == TYPE_FLOAT)
+                            return TYPE_FLOAT;
+                        return TYPE_INT;
+                    }
+                    sem_error(sem, expr->lineno,
                               "Arithmetic operands must be numeric (found %s and %s)",
-                              lt, rt);
-                    return "<error>";
-                }
+                              type_text(sem, lt), type_text(sem, rt));
+                    return TYPE_ERROR;
+
+                /* relational */
+                case OP_EQ:
+                case OP_NE:
+                case OP_LT:
+                case OP_GT:
+                case OP_LE:
+                case OP_GE:
+                    if (lt == rt || (type_is_numeric(lt) && type_is_numeric(rt)))
+                        return TYPE_INT;
+                    sem_error(sem, expr->lineno,
+                              "Incompatible types for relational operation (%s, %s)",
+                              type_text(sem, lt), type_text(sem, rt));
+                    return TYPE_ERROR;
+
+                /* logical */
+                case OP_AND:
+                case OP_OR:
+                    if (lt == TYPE_INT && rt == TYPE_INT)
+                        return TYPE_INT;
+                    sem_error(sem, expr->lineno,
+                              "Logical operands must be integers (found %s and %s)",
+                              type_text(sem, lt), type_text(sem, rt));
+                    return TYPE_ERROR;
+
+                default:
+                    return TYPE_ERROR;
             }
-
-            /* relational */
-            if (strcmp(expr->name, "==") == 0 || strcmp(expr->name, "<>") == 0 ||
-                strcmp(expr->name, "!=") == 0 ||
-                strcmp(expr->name, "<") == 0 || strcmp(expr->name, ">") == 0 ||
-                strcmp(expr->name, "<=") == 0 || strcmp(expr->name, ">=") == 0) {
-                if (strcmp(lt, rt) == 0 ||
-                    ((strcmp(lt, "int") == 0 || strcmp(lt, "float") == 0) &&
-                     (strcmp(rt, "int") == 0 || strcmp(rt, "float") == 0)))
-                    return "int";
-                sem_error(expr->lineno,
-                          "Incompatible types for relational operation (%s, %s)",
-                          lt, rt);
-                return "<error>";
-            }
-
-            /* logical */
-            if (strcmp(expr->name, "&&") == 0 || strcmp(expr->name, "||") == 0 ||
-                strcmp(expr->name, "and") == 0 || strcmp(expr->name, "or") == 0) {
-                if (strcmp(lt, "int") == 0 && strcmp(rt, "int") == 0)
-                    return "int";
-                sem_error(expr->lineno,
-                          "Logical operands must be integers (found %s and %s)",
-                          lt, rt);
-                return "<error>";
-            }
-
-            return "<error>";
         }
 
         case NODE_UNARY_OP: {
-            const char *operand = resolve_type_of_expr(curScope, expr->child);
-            if (!expr->name) return operand;
-            if (strcmp(expr->name, "not") == 0) {
-                if (strcmp(operand, "int") == 0)
-                    return "int";
-                sem_error(expr->lineno,
-                          "Operand of 'not' must be integer (found %s)",
-                          operand);
-                return "<error>";
-            }
-            if (strcmp(expr->name, "+") == 0 || strcmp(expr->name, "-") == 0) {
-                if (is_numeric_type(operand))
+            TypeId operand = resolve_type_of_expr(sem, curScope, ast_child(expr));
+            switch (expr->op) {
+                case OP_NOT:
+                    if (operand == TYPE_INT)
+                        return TYPE_INT;
+                    sem_error(sem, expr->lineno,
+                              "Operand of 'not' must be integer (found %s)",
+                              type_text(sem, operand));
+                    return TYPE_ERROR;
+
+                case OP_POS:
+                case OP_NEG:
+                    if (type_is_numeric(operand))
+                        return operand;
+                    sem_error(sem, expr->lineno,
+                              "Unary %s expects numeric operand (found %s)",
+                              ast_name(expr), type_text(sem, operand));
+                    return TYPE_ERROR;
+
+                default:
                     return operand;
-                sem_error(expr->lineno,
-                          "Unary %s expects numeric operand (found %s)",
-                          expr->name, operand);
-                return "<error>";
             }
-            return operand;
         }
 
         case NODE_FUNCTION_CALL: {
-            Symbol *fn = symtable_lookup(curScope, expr->name);
+            Symbol *fn = symtable_lookup(curScope, expr->nameId);
             if (!fn || fn->kind != SYM_FUNC) {
-                sem_error(expr->lineno,
-                          "Call to undefined function '%s'", expr->name);
-                return "<error>";
+                sem_error(sem, expr->lineno,
+                          "Call to undefined function '%s'", ast_name(expr));
+                return TYPE_ERROR;
             }
+            expr->symbol = fn;
 
             /* argument vs parameter checking */
             int argCount = 0, paramCount = 0;
-            for (AST *a = expr->child; a; a = a->sibling) argCount++;
+            for (AST *a = ast_child(expr); a; a = ast_sibling(a)) argCount++;
             for (Symbol *p = fn->params; p; p = p->next) paramCount++;
 
             if (argCount != paramCount) {
-                sem_error(expr->lineno,
+                sem_error(sem, expr->lineno,
                           "Call to '%s' with wrong number of arguments "
                           "(expected %d, got %d)",
-                          expr->name, paramCount, argCount);
+                          ast_name(expr), paramCount, argCount);
             }
 
-            AST *a = expr->child;
+            AST *a = ast_child(expr);
             Symbol *pp = fn->params;
             while (a && pp) {
-                const char *atype = resolve_type_of_expr(curScope, a);
-                if (strcmp(atype, pp->typeName) != 0)
-                    sem_error(expr->lineno,
+                TypeId atype = resolve_type_of_expr(sem, curScope, a);
+                if (atype != pp->type)
+                    sem_error(sem, expr->lineno,
                               "Argument type mismatch in call to '%s' "
                               "(param %s expects %s, got %s)",
-                              expr->name, pp->name,
-                              pp->typeName ? pp->typeName : "<nil>", atype);
-                a = a->sibling;
+                              ast_name(expr), pp->name,
+                              pp->typeName ? pp->typeName : "<nil>", type_text(sem, atype));
+                a = ast_sibling(a);
                 pp = pp->next;
             }
 
-            return fn->typeName ? fn->typeName : "<nil>";
+            return fn->type;
         }
 
         default:
-            return "<nil>";
+            return TYPE_NIL;
     }
 }
 
+/* the result is also recorded on the node, so an expression is only checked
+   the first time it is asked for and later passes just read typeId */
+static TypeId resolve_type_of_expr(SemanticContext *sem, SymTable *curScope, AST *expr) {
+    if (!expr) return TYPE_VOID_VALUE;
+    if (expr->typeId) return expr->typeId;
+    expr->typeId = infer_expr_type(sem, curScope, expr);
+    return expr->typeId;
+}
+
 /* ----------------------------------------------------- */
 
-static void semantic_passB_visit(AST *node, SymTable *scope, const char *currentReturn);
+/* currentReturn is the enclosing function's return type, 0 outside functions */
+static void semantic_passB_visit(SemanticContext *sem, AST *node, SymTable *scope, TypeId currentReturn);
 
-static void check_assignment(AST *node, SymTable *scope) {
-            AST *lhs = node->child;
-            AST *rhs = lhs ? lhs->sibling : NULL;
+static void check_assignment(SemanticContext *sem, AST *node, SymTable *scope) {
+            AST *lhs = ast_child(node);
+            AST *rhs = lhs ? ast_sibling(lhs) : NULL;
 
             if (!lhs || lhs->kind != NODE_ID) {
-        sem_error(node->lineno, "Left side of assignment must be an identifier");
+        sem_error(sem, node->lineno, "Left side of assignment must be an identifier");
         return;
     }
 
-    const char *lt = resolve_type_of_expr(scope, lhs);
-    const char *rt = resolve_type_of_expr(scope, rhs);
-    if (strcmp(lt, "<error>") == 0 || strcmp(rt, "<error>") == 0)
+    TypeId lt = resolve_type_of_expr(sem, scope, lhs);
+    TypeId rt = resolve_type_of_expr(sem, scope, rhs);
+    if (lt == TYPE_ERROR || rt == TYPE_ERROR)
         return;
 
-                    if (strcmp(lt, rt) != 0) {
-        if (!(strcmp(lt, "float") == 0 && strcmp(rt, "int") == 0)) {
-                            sem_error(node->lineno,
+                    if (lt != rt) {
+        if (!(lt == TYPE_FLOAT && rt == TYPE_INT)) {
+                            sem_error(sem, node->lineno,
                                       "Type mismatch in assignment: left is %s, right is %s",
-                                      lt, rt);
+                                      type_text(sem, lt), type_text(sem, rt));
                         }
                     }
                 }
 
-static void check_condition(AST *condNode, SymTable *scope, const char *keyword) {
-    const char *t = resolve_type_of_expr(scope, condNode);
-    if (!is_numeric_type(t))
-        sem_error(condNode ? condNode->lineno : 0,
+static void check_condition(SemanticContext *sem, AST *condNode, SymTable *scope, const char *keyword) {
+    TypeId t = resolve_type_of_expr(sem, scope, condNode);
+    if (!type_is_numeric(t))
+        sem_error(sem, condNode ? condNode->lineno : 0,
                   "%s condition must be numeric (found %s)",
-                  keyword, t);
+                  keyword, type_text(sem, t));
 }
 
-static void semantic_passB_visit(AST *node, SymTable *scope, const char *currentReturn) {
-    for (AST *p = node; p; p = p->sibling) {
+static void semantic_passB_visit(SemanticContext *sem, AST *node, SymTable *scope, TypeId currentReturn) {
+    for (AST *p = node; p; p = ast_sibling(p)) {
         if (!p) continue;
         switch (p->kind) {
             case NODE_CLASS_DECL: {
-                SymTable *classScope = symtable_find_scope(globalTable, p->name, scope);
+                SymTable *classScope = p->scope;
                 AST *body = get_class_body(p);
-                semantic_passB_visit(body, classScope ? classScope : scope, currentReturn);
+                semantic_passB_visit(sem, body, classScope ? classScope : scope, currentReturn);
                 continue;
             }
             case NODE_FUNC_DECL: {
-                SymTable *fnScope = symtable_find_scope(globalTable, p->name, scope);
-                const char *fnReturn = p->typeName ? p->typeName : "void";
-                if (p->extra)
-                    semantic_passB_visit(p->extra, fnScope ? fnScope : scope, fnReturn);
+                SymTable *fnScope = p->scope;
+                TypeId fnReturn = p->typeNameId ? type_for_name(sem->types, p->typeNameId) : TYPE_VOID;
+                if (ast_extra(p))
+                    semantic_passB_visit(sem, ast_extra(p), fnScope ? fnScope : scope, fnReturn);
                 continue;
             }
             case NODE_FUNC_BODY: {
-                semantic_passB_visit(p->child, scope, currentReturn);
+                semantic_passB_visit(sem, ast_child(p), scope, currentReturn);
                 continue;
             }
             case NODE_ASSIGN:
-                check_assignment(p, scope);
+                check_assignment(sem, p, scope);
             break;
         case NODE_READ: {
-                AST *v = p->child;
+                AST *v = ast_child(p);
             if (!v || v->kind != NODE_ID)
-                    sem_error(p->lineno, "READ expects an identifier");
-                else if (!symtable_lookup(scope, v->name))
-                sem_error(v->lineno, "READ on undeclared variable '%s'", v->name);
+                    sem_error(sem, p->lineno, "READ expects an identifier");
+                else if (!(v->symbol = symtable_lookup(scope, v->nameId)))
+                sem_error(sem, v->lineno, "READ on undeclared variable '%s'", ast_name(v));
             break;
         }
             case NODE_WRITE:
-                (void)resolve_type_of_expr(scope, p->child);
+                (void)resolve_type_of_expr(sem, scope, ast_child(p));
                 break;
         case NODE_RETURN: {
-                const char *exprType = resolve_type_of_expr(scope, p->child);
+                TypeId exprType = resolve_type_of_expr(sem, scope, ast_child(p));
                 if (!currentReturn) {
-                    sem_error(p->lineno, "RETURN outside of a function");
-                } else if (strcmp(currentReturn, "void") == 0) {
-                    if (exprType && strcmp(exprType, "<nil>") != 0 && strcmp(exprType, "<void>") != 0)
-                        sem_error(p->lineno, "Void functions should not return a value");
-                } else if (strcmp(exprType, currentReturn) != 0) {
-                    if (!(strcmp(currentReturn, "float") == 0 && strcmp(exprType, "int") == 0)) {
-                        sem_error(p->lineno,
+                    sem_error(sem, p->lineno, "RETURN outside of a function");
+                } else if (currentReturn == TYPE_VOID) {
+                    if (exprType != TYPE_NIL && exprType != TYPE_VOID_VALUE)
+                        sem_error(sem, p->lineno, "Void functions should not return a value");
+                } else if (exprType != currentReturn) {
+                    if (!(currentReturn == TYPE_FLOAT && exprType == TYPE_INT)) {
+                        sem_error(sem, p->lineno,
                                   "Return type mismatch: expected %s, got %s",
-                                  currentReturn, exprType);
+                                  type_text(sem, currentReturn), type_text(sem, exprType));
                     }
                 }
             break;
         }
             case NODE_IF: {
-                AST *cond = p->child;
-                check_condition(cond, scope, "IF");
-                AST *thenBlock = cond ? cond->sibling : NULL;
-                AST *elseBlock = thenBlock ? thenBlock->sibling : NULL;
-                semantic_passB_visit(thenBlock, scope, currentReturn);
-                semantic_passB_visit(elseBlock, scope, currentReturn);
+                AST *cond = ast_child(p);
+                check_condition(sem, cond, scope, "IF");
+                /* the then block's sibling is the else block, so one walk covers both */
+                AST *thenBlock = cond ? ast_sibling(cond) : NULL;
+                semantic_passB_visit(sem, thenBlock, scope, currentReturn);
                 continue;
             }
             case NODE_WHILE: {
-                AST *cond = p->child;
-                check_condition(cond, scope, "WHILE");
-                AST *body = cond ? cond->sibling : NULL;
-                semantic_passB_visit(body, scope, currentReturn);
+                AST *cond = ast_child(p);
+                check_condition(sem, cond, scope, "WHILE");
+                AST *body = cond ? ast_sibling(cond) : NULL;
+                semantic_passB_visit(sem, body, scope, currentReturn);
                 continue;
             }
         case NODE_FUNCTION_CALL:
         case NODE_BINARY_OP:
         case NODE_UNARY_OP:
         case NODE_ID:
-                (void)resolve_type_of_expr(scope, p);
+                (void)resolve_type_of_expr(sem, scope, p);
             break;
         default:
             break;
     }
 
-        if (p->child)
-            semantic_passB_visit(p->child, scope, currentReturn);
-        if (p->extra)
-            semantic_passB_visit(p->extra, scope, currentReturn);
+        if (ast_child(p))
+            semantic_passB_visit(sem, ast_child(p), scope, currentReturn);
+        if (ast_extra(p))
+            semantic_passB_visit(sem, ast_extra(p), scope, currentReturn);
     }
 }
 
-void semantic_passB(AST *root) {
-    semantic_passB_visit(root, globalTable, NULL);
+void semantic_passB(SemanticContext *sem, AST *root) {
+    semantic_passB_visit(sem, root, sem->globalTable, 0);
         }
 
-int semantic_error_total(void) {
-    return errorCount;
+int semantic_error_total(const SemanticContext *sem) {
+    return sem->errorCount;
 }
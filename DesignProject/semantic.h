@@ -0,0 +1,27 @@
+#ifndef SEMANTIC_H
+#define SEMANTIC_H
+
+#include <stdio.h>
+#include "ast.h"
+#include "symbol_table.h"
+
+#define MAX_ERRORS 1000
+
+/* per-compilation semantic analysis state */
+typedef struct SemanticContext {
+    InternPool *names;             /* the compilation's pool; not owned */
+    TypeTable *types;              /* likewise for type descriptors */
+    SymTable *globalTable;
+    FILE *errFile;                 /* NULL reports to stdout */
+    char *errorMsgs[MAX_ERRORS];   /* reported messages, for de-duplication */
+    int errorCount;
+} SemanticContext;
+
+void semantic_init(SemanticContext *sem, InternPool *names, TypeTable *types, FILE *errFile);
+void semantic_passA(SemanticContext *sem, AST *root);
+void semantic_passB(SemanticContext *sem, AST *root);
+int semantic_error_total(const SemanticContext *sem);
+/* frees the error log and every symbol table */
+void semantic_free(SemanticContext *sem);
+
+#endif
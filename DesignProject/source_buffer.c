@@ -0,0 +1,93 @@
+#include "source_buffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SENTINEL_BYTES 2
+
+/* fallback: copy the file into a heap buffer with the sentinels appended */
+static int read_into_heap(SourceBuffer *buf, FILE *f) {
+    size_t capacity = 65536, length = 0;
+    char *data = (char*)malloc(capacity);
+    if (!data) return 1;
+    for (;;) {
+        if (capacity - length < SENTINEL_BYTES + 1) {
+            char *grown = (char*)realloc(data, capacity * 2);
+            if (!grown) { free(data); return 1; }
+            data = grown;
+            capacity *= 2;
+        }
+        size_t n = fread(data + length, 1, capacity - length - SENTINEL_BYTES, f);
+        if (n == 0) break;
+        length += n;
+    }
+    if (ferror(f)) { free(data); return 1; }
+    memset(data + length, 0, SENTINEL_BYTES);
+    buf->data = data;
+    buf->length = length;
+    buf->mapped = 0;
+    return 0;
+}
+
+#ifndef _WIN32
+/*
+ * Reserve length + sentinels of zeroed anonymous memory, then map the file
+ * privately over the front of it. Bytes past EOF in the file's last page are
+ * zero-filled by the kernel, and the reserved tail supplies the sentinels
+ * when the file ends exactly on a page boundary. The mapping is writable
+ * (copy-on-write) because flex NUL-terminates yytext in place.
+ */
+static int map_file(SourceBuffer *buf, int fd, size_t length) {
+    size_t total = length + SENTINEL_BYTES;
+    char *base = (char*)mmap(NULL, total, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return 1;
+    void *file = mmap(base, length, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (file == MAP_FAILED) {
+        munmap(base, total);
+        return 1;
+    }
+    buf->data = base;
+    buf->length = length;
+    buf->mapped = total;
+    return 0;
+}
+#endif
+
+int source_buffer_open(SourceBuffer *buf, const char *path) {
+    buf->data = NULL;
+    buf->length = buf->mapped = 0;
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 1;
+    struct stat st;
+    int mapped = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+                 map_file(buf, fd, (size_t)st.st_size) == 0;
+    close(fd);
+    if (mapped) return 0;
+#endif
+    FILE *f = fopen(path, "rb");
+    if (!f) return 1;
+    int rc = read_into_heap(buf, f);
+    fclose(f);
+    return rc;
+}
+
+void source_buffer_close(SourceBuffer *buf) {
+    if (!buf || !buf->data) return;
+#ifndef _WIN32
+    if (buf->mapped) munmap(buf->data, buf->mapped);
+    else
+#endif
+        free(buf->data);
+    buf->data = NULL;
+    buf->length = buf->mapped = 0;
+}
@@ -0,0 +1,18 @@
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <stddef.h>
+
+/* a whole source file in memory, followed by the two NUL bytes flex's
+   yy_scan_buffer requires, so the scanner can work on it in place */
+typedef struct {
+    char *data;       /* length bytes of source + 2 NUL sentinels */
+    size_t length;    /* source bytes, excluding the sentinels */
+    size_t mapped;    /* size of the mapping, or 0 if data is heap memory */
+} SourceBuffer;
+
+/* map path (or read it, where mapping is unavailable); 0 on success */
+int source_buffer_open(SourceBuffer *buf, const char *path);
+void source_buffer_close(SourceBuffer *buf);
+
+#endif
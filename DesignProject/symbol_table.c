@@ -1,9 +1,5 @@
 #include "symbol_table.h"
 #include <stdlib.h>
-#include <string.h>
-
-static SymTable *scope_head = NULL;
-static SymTable *scope_tail = NULL;
 
 static const int WORD_SIZE = 4;  /* x86-32 uses 32-bit (4 bytes) words */
 
@@ -12,152 +8,239 @@ static int align_to_word(int value) {
     return remainder == 0 ? value : value + (WORD_SIZE - remainder);
 }
 
-SymTable *symtable_create(const char *scopeName, SymTable *parent) {
+SymTable *symtable_create(InternPool *names, TypeTable *types, InternId scopeName, SymTable *parent) {
     SymTable *t = (SymTable*)malloc(sizeof(SymTable));
-    t->scopeName = scopeName ? strdup(scopeName) : NULL;
+    t->names = names;
+    t->types = types;
+    t->scopeName = intern_str(names, scopeName);
+    t->scopeId = scopeName;
     t->parent = parent;
     t->symbols = NULL;
+    t->slots = NULL;
+    t->slot_capacity = 0;
+    t->symbol_count = 0;
     t->next = NULL;
+    t->registry_tail = NULL;
+    t->same_name = NULL;
+    t->scope_slots = NULL;
+    t->scope_slot_capacity = 0;
+    t->scope_count = 0;
     t->next_offset = 0;
     t->frame_size = 0;
     return t;
 }
 
-Symbol *sym_new(const char *name, const char *typeName, SymKind kind, int lineno) {
+/* x86 cdecl: [EBP+4] = return address, [EBP+8] = first argument; each
+   argument takes its size rounded up to words, so a double takes two.
+   prev is the parameter before this one, if it is known */
+static void param_place(const SymTable *table, Symbol *param, int index, const Symbol *prev) {
+    param->paramIndex = index;
+    if (prev)
+        param->paramOffset = prev->paramOffset + align_to_word(type_size(table->types, prev->type));
+    else
+        param->paramOffset = 8 + index * WORD_SIZE;
+}
+
+static Symbol *sym_new(const SymTable *table, InternId name, TypeId type, SymKind kind, int lineno) {
     Symbol *s = (Symbol*)malloc(sizeof(Symbol));
-    s->name = name ? strdup(name) : NULL;
-    s->typeName = typeName ? strdup(typeName) : NULL;
+    s->name = intern_str(table->names, name);
+    s->typeName = type_name(table->types, type);
+    s->nameId = name;
+    s->type = type;
     s->kind = kind;
     s->lineno = lineno;
     s->size = 0;
     s->offset = -1;
+    s->paramIndex = -1;
+    s->paramOffset = -1;
     s->next = NULL;
     s->params = NULL;
     return s;
 }
 
-int symtable_type_size(const char *typeName) {
-    if (!typeName) return WORD_SIZE;
-    if (strcmp(typeName, "int") == 0 || strcmp(typeName, "integer") == 0) return 4;
-    if (strcmp(typeName, "float") == 0) return 8;
-    if (strcmp(typeName, "void") == 0) return 0;
-    return WORD_SIZE; // treat user types/pointers uniformly
+/* ids are dense, so a multiplicative hash spreads them well enough */
+static unsigned int name_hash(InternId name) {
+    return name * 2654435761u;
 }
 
-/* insert in current scope only. Return 0 on success; 1 if duplicate in same scope */
-int symtable_insert(SymTable *table, const char *name, const char *typeName, SymKind kind, int lineno) {
-    // check duplicates in this scope
-    for (Symbol *p = table->symbols; p; p = p->next) {
-        if (strcmp(p->name, name) == 0) return 1; // duplicate
+/* index lookup within one scope */
+static Symbol *scope_find(const SymTable *table, InternId name) {
+    if (table->slot_capacity == 0) return NULL;
+    unsigned int mask = (unsigned int)table->slot_capacity - 1;
+    for (unsigned int pos = name_hash(name) & mask; table->slots[pos]; pos = (pos + 1) & mask) {
+        if (table->slots[pos]->nameId == name) return table->slots[pos];
     }
-    Symbol *s = sym_new(name, typeName, kind, lineno);
+    return NULL;
+}
+
+static void scope_index(SymTable *table, Symbol *s) {
+    unsigned int mask = (unsigned int)table->slot_capacity - 1;
+    unsigned int pos = name_hash(s->nameId) & mask;
+    while (table->slots[pos]) pos = (pos + 1) & mask;
+    table->slots[pos] = s;
+}
+
+/* keep the index at most half full */
+static int scope_reserve(SymTable *table) {
+    if ((table->symbol_count + 1) * 2 <= table->slot_capacity) return 0;
+    int capacity = table->slot_capacity ? table->slot_capacity * 2 : 16;
+    Symbol **slots = (Symbol**)calloc((size_t)capacity, sizeof(Symbol*));
+    if (!slots) return -1;
+    free(table->slots);
+    table->slots = slots;
+    table->slot_capacity = capacity;
+    for (Symbol *s = table->symbols; s; s = s->next) scope_index(table, s);
+    return 0;
+}
+
+/* insert in current scope only. Return 0 on success; 1 if duplicate in same scope */
+int symtable_insert(SymTable *table, InternId name, TypeId type, SymKind kind, int lineno) {
+    if (scope_find(table, name)) return 1; // duplicate
+    if (scope_reserve(table) != 0) return 1;
+    Symbol *s = sym_new(table, name, type, kind, lineno);
     if (kind == SYM_VAR || kind == SYM_PARAM || kind == SYM_ATTR) {
-        int size = symtable_type_size(typeName);
+        int size = type_size(table->types, type);
         if (size < WORD_SIZE && size > 0) size = WORD_SIZE; // align scalars to word
-        table->next_offset = align_to_word(table->next_offset);
-        table->next_offset += size;
-        table->frame_size = table->next_offset;
-        s->offset = table->next_offset;
         s->size = size;
+        // parameters live above EBP (paramOffset), so they take no frame space
+        if (kind != SYM_PARAM) {
+            table->next_offset = align_to_word(table->next_offset);
+            table->next_offset += size;
+            table->frame_size = table->next_offset;
+            s->offset = table->next_offset;
+        }
     }
     s->next = table->symbols;
     table->symbols = s;
+    scope_index(table, s);
+    table->symbol_count++;
+    return 0;
+}
+
+int symtable_insert_param(SymTable *table, InternId name, TypeId type, int index, int lineno) {
+    if (symtable_insert(table, name, type, SYM_PARAM, lineno) != 0) return 1;
+    const Symbol *prev = NULL;
+    for (const Symbol *s = table->symbols->next; s && index > 0; s = s->next) {
+        if (s->kind == SYM_PARAM && s->paramIndex == index - 1) {
+            prev = s;
+            break;
+        }
+    }
+    param_place(table, table->symbols, index, prev);
     return 0;
 }
 
 /* lookup: climb parents */
-Symbol *symtable_lookup(SymTable *table, const char *name) {
+Symbol *symtable_lookup(SymTable *table, InternId name) {
     for (SymTable *t = table; t; t = t->parent) {
-        for (Symbol *s = t->symbols; s; s = s->next) {
-            if (strcmp(s->name, name) == 0) return s;
-        }
+        Symbol *s = scope_find(t, name);
+        if (s) return s;
     }
     return NULL;
 }
 
-void symtable_add_param(Symbol *funcSym, const char *name, const char *typeName, int lineno) {
-    Symbol *param = sym_new(name, typeName, SYM_PARAM, lineno);
+void symtable_add_param(SymTable *table, Symbol *funcSym, InternId name, TypeId type, int lineno) {
+    Symbol *param = sym_new(table, name, type, SYM_PARAM, lineno);
     if (!funcSym->params) {
     funcSym->params = param;
+        param_place(table, param, 0, NULL);
     } else {
         Symbol *tail = funcSym->params;
         while (tail->next) tail = tail->next;
         tail->next = param;
+        param_place(table, param, tail->paramIndex + 1, tail);
     }
 }
 
+/* the registry is the list of scopes chained through `next`, headed by the
+   global table, which also remembers the tail. The global table also keeps
+   a hash index by scopeName; scopes sharing a name are chained through
+   same_name in registration order. */
+static SymTable **registry_slot(SymTable *global, InternId scopeName) {
+    unsigned int mask = (unsigned int)global->scope_slot_capacity - 1;
+    unsigned int pos = name_hash(scopeName) & mask;
+    while (global->scope_slots[pos] && global->scope_slots[pos]->scopeId != scopeName)
+        pos = (pos + 1) & mask;
+    return &global->scope_slots[pos];
+}
+
+static int registry_reserve(SymTable *global) {
+    if ((global->scope_count + 1) * 2 <= global->scope_slot_capacity) return 0;
+    int capacity = global->scope_slot_capacity ? global->scope_slot_capacity * 2 : 16;
+    SymTable **old = global->scope_slots;
+    int oldCapacity = global->scope_slot_capacity;
+    global->scope_slots = (SymTable**)calloc((size_t)capacity, sizeof(SymTable*));
+    if (!global->scope_slots) {
+        global->scope_slots = old;
+        return -1;
+    }
+    global->scope_slot_capacity = capacity;
+    for (int i = 0; i < oldCapacity; i++)
+        if (old[i]) *registry_slot(global, old[i]->scopeId) = old[i];
+    free(old);
+    return 0;
+}
+
+static void registry_index(SymTable *global, SymTable *scope) {
+    if (!scope->scopeId || registry_reserve(global) != 0) return;
+    SymTable **slot = registry_slot(global, scope->scopeId);
+    if (!*slot) {
+        *slot = scope;
+        global->scope_count++;
+        return;
+    }
+    SymTable *last = *slot;
+    while (last->same_name) last = last->same_name;
+    last->same_name = scope;
+}
+
 void symtable_registry_reset(SymTable *global) {
-    scope_head = global;
-    scope_tail = global;
-    if (scope_head) scope_head->next = NULL;
+    if (!global) return;
+    global->next = NULL;
+    global->registry_tail = global;
+    free(global->scope_slots);
+    global->scope_slots = NULL;
+    global->scope_slot_capacity = 0;
+    global->scope_count = 0;
+    global->same_name = NULL;
+    registry_index(global, global);
 }
 
 void symtable_register_scope(SymTable *scope) {
-    if (!scope) return;
+    if (!scope || !scope->parent) return;
+    SymTable *global = scope->parent;
+    while (global->parent) global = global->parent;
+    if (!global->registry_tail) symtable_registry_reset(global);
     scope->next = NULL;
-    if (!scope_head) {
-        scope_head = scope_tail = scope;
-    } else {
-        scope_tail->next = scope;
-        scope_tail = scope;
-    }
+    global->registry_tail->next = scope;
+    global->registry_tail = scope;
+    registry_index(global, scope);
 }
 
-SymTable *symtable_find_scope(SymTable *global, const char *scopeName, SymTable *parent) {
-    SymTable *start = scope_head ? scope_head : global;
-    for (SymTable *t = start; t; t = t->next) {
-        if (scopeName && t->scopeName && strcmp(t->scopeName, scopeName) == 0) {
-            if (!parent || t->parent == parent) return t;
-        }
+/* first registered scope named scopeName whose parent is parent (any parent if NULL) */
+SymTable *symtable_find_scope(SymTable *global, InternId scopeName, SymTable *parent) {
+    if (!global || !scopeName || global->scope_slot_capacity == 0) return NULL;
+    for (SymTable *t = *registry_slot(global, scopeName); t; t = t->same_name) {
+        if (!parent || t->parent == parent) return t;
     }
     return NULL;
 }
 
 void symtable_print_all(SymTable *global, FILE *out) {
-    SymTable *start = scope_head ? scope_head : global;
-    SymTable *t = start;
+    SymTable *t = global;
     while (t) {
         fprintf(out, "Scope: %s\n", t->scopeName ? t->scopeName : "anon");
         fprintf(out, "  frame_size = %d bytes\n", t->frame_size);
         
-        /* find function symbol for this scope to get parameter list */
-        Symbol *funcSym = NULL;
-        if (t->parent) {
-            /* look for function symbol in parent scope */
-            for (Symbol *fs = t->parent->symbols; fs; fs = fs->next) {
-                if (fs->kind == SYM_FUNC && fs->name && t->scopeName && strcmp(fs->name, t->scopeName) == 0) {
-                    funcSym = fs;
-                    break;
-                }
-            }
-        }
-        
         for (Symbol *s = t->symbols; s; s = s->next) {
             const char *k = (s->kind==SYM_VAR?"VAR": s->kind==SYM_FUNC?"FUNC": s->kind==SYM_CLASS?"CLASS": s->kind==SYM_PARAM?"PARAM":"ATTR");
-            if (s->offset >= 0) {
-                if (s->kind == SYM_PARAM && funcSym && funcSym->params) {
-                    /* calculate EBP offset for parameter: first param at EBP+8, second at EBP+12, etc. */
-                    int paramIndex = 0;
-                    for (Symbol *p = funcSym->params; p; p = p->next) {
-                        if (p->name && s->name && strcmp(p->name, s->name) == 0) {
-                            int ebp_offset = 8 + (paramIndex * WORD_SIZE);
-                            fprintf(out, "  %s\t%s\t%s\t(line %d)\tEBP+%d size=%d\n", 
-                                    s->name, s->typeName? s->typeName:"<nil>", k, s->lineno, ebp_offset, s->size);
-                            break;
-                        }
-                        paramIndex++;
-                    }
-                    if (paramIndex == 0 && funcSym->params && funcSym->params->name && s->name && 
-                        strcmp(funcSym->params->name, s->name) != 0) {
-                        /* parameter not found in list, use stored offset */
-                        fprintf(out, "  %s\t%s\t%s\t(line %d)\toffset=%d size=%d\n", 
-                                s->name, s->typeName? s->typeName:"<nil>", k, s->lineno, s->offset, s->size);
-                    }
-                } else {
-                    /* local variable: negative offset from EBP */
-                    fprintf(out, "  %s\t%s\t%s\t(line %d)\tEBP-%d size=%d\n", 
-                            s->name, s->typeName? s->typeName:"<nil>", k, s->lineno, s->offset, s->size);
-                }
+            if (s->kind == SYM_PARAM && s->paramOffset > 0) {
+                fprintf(out, "  %s\t%s\t%s\t(line %d)\tEBP+%d size=%d\n", 
+                        s->name, s->typeName? s->typeName:"<nil>", k, s->lineno, s->paramOffset, s->size);
+            } else if (s->offset >= 0) {
+                /* local variable: negative offset from EBP */
+                fprintf(out, "  %s\t%s\t%s\t(line %d)\tEBP-%d size=%d\n", 
+                        s->name, s->typeName? s->typeName:"<nil>", k, s->lineno, s->offset, s->size);
             } else {
                 fprintf(out, "  %s\t%s\t%s\t(line %d)\n", s->name, s->typeName? s->typeName:"<nil>", k, s->lineno);
             }
@@ -173,8 +256,24 @@ void symtable_print_all(SymTable *global, FILE *out) {
     }
 }
 
-/* free helpers omitted for brevity (not needed for short-run tools) */
+static void sym_free_list(Symbol *s) {
+    while (s) {
+        Symbol *next = s->next;
+        sym_free_list(s->params);
+        free(s);
+        s = next;
+    }
+}
+
+/* release every registered scope; global must be the registry head */
 void symtable_free_all(SymTable *global) {
-    // naive: do nothing (OS will reclaim memory). Implement if needed.
-    (void)global;
+    SymTable *t = global;
+    while (t) {
+        SymTable *next = t->next;
+        sym_free_list(t->symbols);
+        free(t->slots);
+        free(t->scope_slots);
+        free(t);
+        t = next;
+    }
 }
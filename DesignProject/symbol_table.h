@@ -2,40 +2,60 @@
 #define SYMBOL_TABLE_H
 
 #include "ast.h"
+#include "intern.h"
+#include "types.h"
 #include <stdio.h>
 
 typedef enum { SYM_VAR, SYM_FUNC, SYM_CLASS, SYM_PARAM, SYM_ATTR } SymKind;
 
+/* names are interned: compare nameId/type, print name/typeName */
 typedef struct Symbol {
-    char *name;
-    char *typeName;   // e.g., "integer", "float", or classname
+    const char *name;
+    const char *typeName;   // e.g., "int", "float", or classname
+    InternId nameId;
+    TypeId type;
     SymKind kind;
     int lineno;
     int size;         // bytes reserved (for data-bearing symbols)
     int offset;       // stack-frame offset
+    int paramIndex;   // SYM_PARAM: position in the parameter list, -1 otherwise
+    int paramOffset;  // SYM_PARAM: EBP-relative offset of the argument, -1 otherwise
     struct Symbol *next;
     // for functions: parameter types as linked list of Symbols (kind SYM_PARAM)
     struct Symbol *params; // head of param list
 } Symbol;
 
 typedef struct SymTable {
-    char *scopeName;
+    InternPool *names; // the compilation's pool, shared by every scope
+    TypeTable *types;  // likewise for type descriptors
+    const char *scopeName;
+    InternId scopeId;
     struct SymTable *parent;
-    Symbol *symbols;   // linked list
+    Symbol *symbols;   // linked list, newest first (printing order)
+    Symbol **slots;    // open-addressing index over symbols by name
+    int slot_capacity; // power of two, or 0 before the first insert
+    int symbol_count;
     struct SymTable *next; // for listing scopes
+    struct SymTable *registry_tail; // last registered scope (set on the global table only)
+    struct SymTable *same_name;     // next registered scope with this scopeName
+    struct SymTable **scope_slots;  // global only: scopes by name, first registered per name
+    int scope_slot_capacity;
+    int scope_count;
     int next_offset;   // next assignable frame offset
     int frame_size;    // total bytes reserved for scope
 } SymTable;
 
 /* creation & lookup */
-SymTable *symtable_create(const char *scopeName, SymTable *parent);
-Symbol *symtable_lookup(SymTable *table, const char *name);
-int symtable_insert(SymTable *table, const char *name, const char *typeName, SymKind kind, int lineno);
-void symtable_add_param(Symbol *funcSym, const char *name, const char *typeName, int lineno);
+SymTable *symtable_create(InternPool *names, TypeTable *types, InternId scopeName, SymTable *parent);
+Symbol *symtable_lookup(SymTable *table, InternId name);
+int symtable_insert(SymTable *table, InternId name, TypeId type, SymKind kind, int lineno);
+/* symtable_insert for the index-th parameter of the function table belongs to */
+int symtable_insert_param(SymTable *table, InternId name, TypeId type, int index, int lineno);
+/* table is the scope funcSym was inserted into */
+void symtable_add_param(SymTable *table, Symbol *funcSym, InternId name, TypeId type, int lineno);
 void symtable_registry_reset(SymTable *global);
 void symtable_register_scope(SymTable *scope);
-SymTable *symtable_find_scope(SymTable *global, const char *scopeName, SymTable *parent);
-int symtable_type_size(const char *typeName);
+SymTable *symtable_find_scope(SymTable *global, InternId scopeName, SymTable *parent);
 
 /* printing */
 void symtable_print_all(SymTable *global, FILE *out);
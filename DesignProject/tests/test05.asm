@@ -0,0 +1,203 @@
+; Auto-generated x86-32 assembly code
+; Target: x86 (32-bit) architecture
+; Calling convention: cdecl (caller cleans stack)
+
+    .686
+    .xmm
+    .model flat, c
+    .code
+
+_across:
+    push EBP
+    mov EBP, ESP
+    sub ESP, 12    ; reserve space for locals and spill slots
+    push EDI    ; save callee-saved register
+    push ESI    ; save callee-saved register
+    push EBX    ; save callee-saved register
+    mov EAX, DWORD PTR [EBP+8]
+    imul EAX, DWORD PTR [EBP+12]    ; b (parameter)
+    mov DWORD PTR [EBP-8], EAX
+    mov EAX, DWORD PTR [EBP+16]
+    imul EAX, DWORD PTR [EBP+20]    ; d (parameter)
+    mov DWORD PTR [EBP-12], EAX
+    mov EDI, DWORD PTR [EBP+8]    ; a (parameter)
+    imul EDI, DWORD PTR [EBP+16]    ; c (parameter)
+    mov EBX, DWORD PTR [EBP+12]    ; b (parameter)
+    imul EBX, DWORD PTR [EBP+20]    ; d (parameter)
+    mov ECX, DWORD PTR [EBP+8]    ; a (parameter)
+    mov ESI, DWORD PTR [EBP+12]    ; b (parameter)
+    mov EAX, ECX
+    cdq    ; sign extend EAX to EDX:EAX
+    push ESI
+    idiv DWORD PTR [ESP]    ; EAX = EDX:EAX / [ESP]
+    add ESP, 4    ; clean up stack
+    mov ECX, EAX
+    push ECX
+    call _twice
+    add ESP, 4    ; clean up stack
+    mov ECX, EAX
+    add EBX, ECX
+    add EDI, EBX
+    add DWORD PTR [EBP-12], EDI
+    mov EAX, DWORD PTR [EBP-12]
+    add DWORD PTR [EBP-8], EAX
+    mov EAX, DWORD PTR [EBP-8]
+    mov DWORD PTR [EBP-4], EAX    ; r (local)
+    push DWORD PTR [EBP-4]    ; r (local)
+    call _twice
+    add ESP, 4    ; clean up stack
+    mov ECX, EAX
+    sub DWORD PTR [EBP-8], ECX
+    mov ECX, DWORD PTR [EBP+16]    ; c (parameter)
+    mov EBX, DWORD PTR [EBP+20]    ; d (parameter)
+    mov EAX, ECX
+    cdq    ; sign extend EAX to EDX:EAX
+    push EBX
+    idiv DWORD PTR [ESP]    ; EAX = EDX:EAX / [ESP]
+    add ESP, 4    ; clean up stack
+    mov ECX, EAX
+    mov EAX, DWORD PTR [EBP-8]
+    imul EAX, ECX
+    mov DWORD PTR [EBP-8], EAX
+    mov DWORD PTR [EBP-4], EAX    ; r (local)
+    mov EAX, DWORD PTR [EBP-8]
+_across_END:
+    pop EBX    ; restore callee-saved register
+    pop ESI    ; restore callee-saved register
+    pop EDI    ; restore callee-saved register
+    mov ESP, EBP
+    pop EBP
+    ret
+
+_deep:
+    push EBP
+    mov EBP, ESP
+    sub ESP, 8    ; reserve space for locals and spill slots
+    push EDI    ; save callee-saved register
+    push ESI    ; save callee-saved register
+    push EBX    ; save callee-saved register
+    mov EAX, DWORD PTR [EBP+8]
+    mov DWORD PTR [EBP-8], EAX    ; a (parameter)
+    mov EAX, DWORD PTR [EBP+12]
+    sub DWORD PTR [EBP-8], EAX    ; b (parameter)
+    mov EDX, DWORD PTR [EBP+12]    ; b (parameter)
+    add EDX, DWORD PTR [EBP+16]    ; c (parameter)
+    mov EAX, DWORD PTR [EBP-8]
+    imul EAX, EDX
+    mov DWORD PTR [EBP-8], EAX
+    mov EDX, DWORD PTR [EBP+16]    ; c (parameter)
+    sub EDX, DWORD PTR [EBP+20]    ; d (parameter)
+    mov EBX, DWORD PTR [EBP+20]    ; d (parameter)
+    add EBX, DWORD PTR [EBP+8]    ; a (parameter)
+    imul EDX, EBX
+    sub DWORD PTR [EBP-8], EDX
+    mov EDX, DWORD PTR [EBP+8]    ; a (parameter)
+    sub EDX, DWORD PTR [EBP+16]    ; c (parameter)
+    mov EBX, DWORD PTR [EBP+12]    ; b (parameter)
+    add EBX, DWORD PTR [EBP+20]    ; d (parameter)
+    imul EDX, EBX
+    mov EBX, DWORD PTR [EBP+16]    ; c (parameter)
+    sub EBX, DWORD PTR [EBP+8]    ; a (parameter)
+    mov ESI, DWORD PTR [EBP+20]    ; d (parameter)
+    add ESI, DWORD PTR [EBP+12]    ; b (parameter)
+    imul EBX, ESI
+    sub EDX, EBX
+    mov EAX, DWORD PTR [EBP-8]
+    imul EAX, EDX
+    mov DWORD PTR [EBP-8], EAX
+    mov EDX, DWORD PTR [EBP+8]    ; a (parameter)
+    sub EDX, DWORD PTR [EBP+20]    ; d (parameter)
+    mov EBX, DWORD PTR [EBP+12]    ; b (parameter)
+    add EBX, DWORD PTR [EBP+8]    ; a (parameter)
+    imul EDX, EBX
+    mov EBX, DWORD PTR [EBP+16]    ; c (parameter)
+    sub EBX, DWORD PTR [EBP+12]    ; b (parameter)
+    mov ESI, DWORD PTR [EBP+20]    ; d (parameter)
+    add ESI, DWORD PTR [EBP+16]    ; c (parameter)
+    imul EBX, ESI
+    sub EDX, EBX
+    mov EBX, DWORD PTR [EBP+8]    ; a (parameter)
+    sub EBX, DWORD PTR [EBP+8]    ; a (parameter)
+    mov ESI, DWORD PTR [EBP+12]    ; b (parameter)
+    add ESI, DWORD PTR [EBP+12]    ; b (parameter)
+    imul EBX, ESI
+    mov ESI, DWORD PTR [EBP+16]    ; c (parameter)
+    sub ESI, DWORD PTR [EBP+16]    ; c (parameter)
+    mov EDI, DWORD PTR [EBP+20]    ; d (parameter)
+    add EDI, DWORD PTR [EBP+20]    ; d (parameter)
+    imul ESI, EDI
+    sub EBX, ESI
+    imul EDX, EBX
+    sub DWORD PTR [EBP-8], EDX
+    mov EDX, DWORD PTR [EBP+8]    ; a (parameter)
+    sub EDX, DWORD PTR [EBP+12]    ; b (parameter)
+    mov EBX, DWORD PTR [EBP+12]    ; b (parameter)
+    add EBX, DWORD PTR [EBP+16]    ; c (parameter)
+    imul EDX, EBX
+    mov EBX, DWORD PTR [EBP+16]    ; c (parameter)
+    sub EBX, DWORD PTR [EBP+20]    ; d (parameter)
+    mov ESI, DWORD PTR [EBP+20]    ; d (parameter)
+    add ESI, DWORD PTR [EBP+8]    ; a (parameter)
+    imul EBX, ESI
+    sub EDX, EBX
+    mov EBX, DWORD PTR [EBP+8]    ; a (parameter)
+    sub EBX, DWORD PTR [EBP+16]    ; c (parameter)
+    mov ESI, DWORD PTR [EBP+12]    ; b (parameter)
+    add ESI, DWORD PTR [EBP+20]    ; d (parameter)
+    imul EBX, ESI
+    mov ESI, DWORD PTR [EBP+16]    ; c (parameter)
+    sub ESI, DWORD PTR [EBP+8]    ; a (parameter)
+    mov EDI, DWORD PTR [EBP+20]    ; d (parameter)
+    add EDI, DWORD PTR [EBP+12]    ; b (parameter)
+    imul ESI, EDI
+    sub EBX, ESI
+    imul EDX, EBX
+    mov EBX, DWORD PTR [EBP+8]    ; a (parameter)
+    sub EBX, DWORD PTR [EBP+20]    ; d (parameter)
+    mov ESI, DWORD PTR [EBP+12]    ; b (parameter)
+    add ESI, DWORD PTR [EBP+8]    ; a (parameter)
+    imul EBX, ESI
+    mov ESI, DWORD PTR [EBP+16]    ; c (parameter)
+    sub ESI, DWORD PTR [EBP+12]    ; b (parameter)
+    mov EDI, DWORD PTR [EBP+20]    ; d (parameter)
+    add EDI, DWORD PTR [EBP+16]    ; c (parameter)
+    imul ESI, EDI
+    sub EBX, ESI
+    mov ESI, DWORD PTR [EBP+8]    ; a (parameter)
+    sub ESI, DWORD PTR [EBP+8]    ; a (parameter)
+    mov EDI, DWORD PTR [EBP+12]    ; b (parameter)
+    add EDI, DWORD PTR [EBP+12]    ; b (parameter)
+    imul ESI, EDI
+    mov EDI, DWORD PTR [EBP+16]    ; c (parameter)
+    sub EDI, DWORD PTR [EBP+16]    ; c (parameter)
+    mov ECX, DWORD PTR [EBP+20]    ; d (parameter)
+    add ECX, DWORD PTR [EBP+20]    ; d (parameter)
+    imul EDI, ECX
+    sub ESI, EDI
+    imul EBX, ESI
+    sub EDX, EBX
+    mov EAX, DWORD PTR [EBP-8]
+    imul EAX, EDX
+    mov DWORD PTR [EBP-8], EAX
+    mov DWORD PTR [EBP-4], EAX    ; r (local)
+    mov EAX, DWORD PTR [EBP-8]
+_deep_END:
+    pop EBX    ; restore callee-saved register
+    pop ESI    ; restore callee-saved register
+    pop EDI    ; restore callee-saved register
+    mov ESP, EBP
+    pop EBP
+    ret
+
+_twice:
+    push EBP
+    mov EBP, ESP
+    mov ECX, DWORD PTR [EBP+8]    ; n (parameter)
+    add ECX, DWORD PTR [EBP+8]    ; n (parameter)
+    mov EAX, ECX
+_twice_END:
+    mov ESP, EBP
+    pop EBP
+    ret
+
+    end
@@ -0,0 +1,54 @@
+; Auto-generated x86-32 assembly code
+; Target: x86 (32-bit) architecture
+; Calling convention: cdecl (caller cleans stack)
+
+    .686
+    .xmm
+    .model flat, c
+    .code
+
+_loop:
+    push EBP
+    mov EBP, ESP
+    sub ESP, 8    ; reserve space for locals
+    mov ECX, DWORD PTR [EBP+8]    ; n (parameter)
+    mov DWORD PTR [EBP-4], ECX    ; s (local)
+    mov DWORD PTR [EBP-8], 0    ; i (local)
+L_while_top_000:
+    mov ECX, DWORD PTR [EBP-8]    ; i (local)
+    cmp ECX, DWORD PTR [EBP+8]    ; n (parameter)
+    jge L_while_end_001
+    mov ECX, DWORD PTR [EBP-4]    ; s (local)
+    imul ECX, DWORD PTR [EBP-8]    ; i (local)
+    mov DWORD PTR [EBP-4], ECX    ; s (local)
+    mov ECX, DWORD PTR [EBP-8]    ; i (local)
+    add ECX, 1
+    mov DWORD PTR [EBP-8], ECX    ; i (local)
+    jmp L_while_top_000
+L_while_end_001:
+    mov EAX, DWORD PTR [EBP-4]    ; s (local)
+_loop_END:
+    mov ESP, EBP
+    pop EBP
+    ret
+
+_area:
+    push EBP
+    mov EBP, ESP
+    sub ESP, 8    ; reserve space for locals
+    mov ECX, DWORD PTR [EBP+8]    ; w (parameter)
+    imul ECX, DWORD PTR [EBP+12]    ; h (parameter)
+    mov DWORD PTR [EBP-4], ECX    ; a (local)
+    add ECX, DWORD PTR [EBP+8]    ; w (parameter)
+    imul ECX, DWORD PTR [EBP-4]    ; a (local)
+    mov DWORD PTR [EBP-8], ECX    ; b (local)
+    mov ECX, DWORD PTR [EBP+12]    ; h (parameter)
+    mov DWORD PTR [EBP-4], ECX    ; a (local)
+    add ECX, DWORD PTR [EBP-8]    ; b (local)
+    mov EAX, ECX
+_area_END:
+    mov ESP, EBP
+    pop EBP
+    ret
+
+    end
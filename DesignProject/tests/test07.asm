@@ -0,0 +1,93 @@
+; Auto-generated x86-32 assembly code
+; Target: x86 (32-bit) architecture
+; Calling convention: cdecl (caller cleans stack)
+
+    .686
+    .xmm
+    .model flat, c
+    .code
+
+_both:
+    push EBP
+    mov EBP, ESP
+    sub ESP, 4    ; reserve space for locals
+    push DWORD PTR [EBP+8]    ; n (parameter)
+    call _bycon
+    add ESP, 4    ; clean up stack
+    mov ECX, EAX
+    mov DWORD PTR [EBP-4], ECX    ; r (local)
+    mov ECX, DWORD PTR [EBP+8]    ; n (parameter)
+    neg ECX    ; negate
+    push ECX
+    call _bycon
+    add ESP, 4    ; clean up stack
+    mov ECX, EAX
+    mov DWORD PTR [EBP-4], ECX    ; r (local)
+    mov EAX, ECX
+_both_END:
+    mov ESP, EBP
+    pop EBP
+    ret
+
+_bycon:
+    push EBP
+    mov EBP, ESP
+    push EBX    ; save callee-saved register
+    mov ECX, DWORD PTR [EBP+8]    ; x (parameter)
+    mov EAX, -1840700269
+    imul ECX    ; EDX:EAX = n * magic
+    mov EBX, EDX
+    add EBX, ECX
+    sar EBX, 2
+    mov ECX, EBX
+    shr ECX, 31
+    add EBX, ECX    ; / 7
+    push EBX
+    call _write    ; write output
+    add ESP, 4
+    mov ECX, DWORD PTR [EBP+8]    ; x (parameter)
+    mov EAX, 1431655766
+    imul ECX    ; EDX:EAX = n * magic
+    mov ECX, EDX
+    shr EDX, 31
+    add ECX, EDX    ; / 3
+    neg ECX
+    push ECX
+    call _write    ; write output
+    add ESP, 4
+    mov ECX, DWORD PTR [EBP+8]    ; x (parameter)
+    mov EDX, ECX
+    sar EDX, 31
+    shr EDX, 30
+    add ECX, EDX
+    sar ECX, 2    ; / 4
+    push ECX
+    call _write    ; write output
+    add ESP, 4
+    mov ECX, DWORD PTR [EBP+8]    ; x (parameter)
+    mov EDX, ECX
+    sar EDX, 31
+    shr EDX, 29
+    add ECX, EDX
+    sar ECX, 3    ; / 8
+    neg ECX
+    push ECX
+    call _write    ; write output
+    add ESP, 4
+    mov ECX, DWORD PTR [EBP+8]    ; x (parameter)
+    shl ECX, 2    ; * 4
+    neg ECX
+    push ECX
+    call _write    ; write output
+    add ESP, 4
+    push 0
+    call _write    ; write output
+    add ESP, 4
+    mov EAX, 0
+_bycon_END:
+    pop EBX    ; restore callee-saved register
+    mov ESP, EBP
+    pop EBP
+    ret
+
+    end
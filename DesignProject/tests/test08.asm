@@ -0,0 +1,52 @@
+; Auto-generated x86-32 assembly code
+; Target: x86 (32-bit) architecture
+; Calling convention: cdecl (caller cleans stack)
+
+    .686
+    .xmm
+    .model flat, c
+    .data
+float_0 DQ -0.00000000000000000e+00    ; float constant
+
+    .code
+
+_fold:
+    push EBP
+    mov EBP, ESP
+    sub ESP, 8    ; reserve space for locals
+    push EBX    ; save callee-saved register
+    mov DWORD PTR [EBP-4], 42    ; k (local)
+    mov ECX, DWORD PTR [EBP+8]    ; x (parameter)
+    add ECX, 42
+    shl ECX, 1    ; * 2
+    mov DWORD PTR [EBP-8], ECX    ; y (local)
+    push 40
+    call _write    ; write output
+    add ESP, 4
+    mov ECX, DWORD PTR [EBP+8]    ; x (parameter)
+    mov EBX, 0
+    mov EAX, ECX
+    cdq    ; sign extend EAX to EDX:EAX
+    push EBX
+    idiv DWORD PTR [ESP]    ; EAX = EDX:EAX / [ESP]
+    add ESP, 4    ; clean up stack
+    mov ECX, EAX
+    push ECX
+    call _write    ; write output
+    add ESP, 4
+    push -2147483648
+    call _write    ; write output
+    add ESP, 4
+    movsd XMM0, QWORD PTR [float_0]    ; float literal: -0
+    sub ESP, 8
+    movsd QWORD PTR [ESP], XMM0
+    call _writef    ; write float output
+    add ESP, 8
+    mov EAX, DWORD PTR [EBP-8]    ; y (local)
+_fold_END:
+    pop EBX    ; restore callee-saved register
+    mov ESP, EBP
+    pop EBP
+    ret
+
+    end
@@ -0,0 +1,81 @@
+; Auto-generated x86-32 assembly code
+; Target: x86 (32-bit) architecture
+; Calling convention: cdecl (caller cleans stack)
+
+    .686
+    .xmm
+    .model flat, c
+    .code
+
+_pick:
+    push EBP
+    mov EBP, ESP
+    sub ESP, 4    ; reserve space for locals
+    mov DWORD PTR [EBP-4], 0    ; r (local)
+    mov ECX, DWORD PTR [EBP+8]    ; a (parameter)
+    cmp ECX, 0
+    jle L_if_else_000
+    mov ECX, DWORD PTR [EBP-4]    ; r (local)
+    add ECX, 1
+    mov DWORD PTR [EBP-4], ECX    ; r (local)
+    push ECX
+    call _write    ; write output
+    add ESP, 4
+    jmp L_if_end_001
+L_if_else_000:
+    mov ECX, DWORD PTR [EBP-4]    ; r (local)
+    sub ECX, 1
+    mov DWORD PTR [EBP-4], ECX    ; r (local)
+    push ECX
+    call _write    ; write output
+    add ESP, 4
+L_if_end_001:
+    mov ECX, DWORD PTR [EBP+8]    ; a (parameter)
+    cmp ECX, 5
+    jle L_if_else_002
+    jmp L_if_end_003
+L_if_else_002:
+    mov ECX, DWORD PTR [EBP-4]    ; r (local)
+    add ECX, 10
+    mov DWORD PTR [EBP-4], ECX    ; r (local)
+L_if_end_003:
+    mov ECX, DWORD PTR [EBP+8]    ; a (parameter)
+    cmp ECX, 10
+    jle L_if_else_004
+    mov ECX, DWORD PTR [EBP-4]    ; r (local)
+    shl ECX, 1    ; * 2
+    mov DWORD PTR [EBP-4], ECX    ; r (local)
+    jmp L_if_end_005
+L_if_else_004:
+L_if_end_005:
+    mov ECX, DWORD PTR [EBP+8]    ; a (parameter)
+    cmp ECX, 1
+    jle L_if_else_006
+    mov ECX, DWORD PTR [EBP+8]    ; a (parameter)
+    cmp ECX, 2
+    jle L_if_else_008
+    mov ECX, DWORD PTR [EBP-4]    ; r (local)
+    add ECX, 100
+    mov DWORD PTR [EBP-4], ECX    ; r (local)
+    push ECX
+    call _write    ; write output
+    add ESP, 4
+    jmp L_if_end_009
+L_if_else_008:
+    mov ECX, DWORD PTR [EBP-4]    ; r (local)
+    add ECX, 200
+    mov DWORD PTR [EBP-4], ECX    ; r (local)
+L_if_end_009:
+    push DWORD PTR [EBP-4]    ; r (local)
+    call _write    ; write output
+    add ESP, 4
+    jmp L_if_end_007
+L_if_else_006:
+L_if_end_007:
+    mov EAX, DWORD PTR [EBP-4]    ; r (local)
+_pick_END:
+    mov ESP, EBP
+    pop EBP
+    ret
+
+    end
@@ -0,0 +1,108 @@
+#include <stdlib.h>
+#include "types.h"
+
+#define WORD_SIZE 4  /* x86-32 */
+
+/* indexed by the TYPE_* constants in types.h */
+static const Type builtins[TYPE_BUILTIN_END] = {
+    {0, TYPE_KIND_SPECIAL, 0, 0},
+    {INTERN_ERROR, TYPE_KIND_SPECIAL, WORD_SIZE, WORD_SIZE},
+    {INTERN_NIL, TYPE_KIND_SPECIAL, WORD_SIZE, WORD_SIZE},
+    {INTERN_VOID_VALUE, TYPE_KIND_SPECIAL, WORD_SIZE, WORD_SIZE},
+    {INTERN_VOID, TYPE_KIND_VOID, 0, 1},
+    {INTERN_INT, TYPE_KIND_INT, 4, 4},
+    {INTERN_FLOAT, TYPE_KIND_FLOAT, 8, WORD_SIZE},   /* doubles are word-aligned on x86-32 */
+    {INTERN_STRING, TYPE_KIND_STRING, WORD_SIZE, WORD_SIZE}
+};
+
+struct TypeTable {
+    InternPool *names;
+    Type *types;                   /* by id; types[0] is unused */
+    TypeId count;
+    TypeId capacity;
+    TypeId *by_name;               /* indexed by InternId; 0 if not seen yet */
+    InternId by_name_capacity;
+};
+
+static int reserve_name(TypeTable *types, InternId name) {
+    if (name < types->by_name_capacity) return 0;
+    InternId capacity = types->by_name_capacity ? types->by_name_capacity : 64;
+    while (capacity <= name) capacity *= 2;
+    TypeId *grown = (TypeId*)realloc(types->by_name, capacity * sizeof(TypeId));
+    if (!grown) return -1;
+    for (InternId i = types->by_name_capacity; i < capacity; i++) grown[i] = 0;
+    types->by_name = grown;
+    types->by_name_capacity = capacity;
+    return 0;
+}
+
+static TypeId add_type(TypeTable *types, const Type *type) {
+    if (reserve_name(types, type->name) != 0) return 0;
+    if (types->count == types->capacity) {
+        TypeId capacity = types->capacity * 2;
+        Type *grown = (Type*)realloc(types->types, capacity * sizeof(Type));
+        if (!grown) return 0;
+        types->types = grown;
+        types->capacity = capacity;
+    }
+    TypeId id = types->count++;
+    types->types[id] = *type;
+    types->by_name[type->name] = id;
+    return id;
+}
+
+TypeTable *type_table_create(InternPool *names) {
+    TypeTable *types = (TypeTable*)calloc(1, sizeof(TypeTable));
+    if (!types) return NULL;
+    types->names = names;
+    types->capacity = 32;
+    types->types = (Type*)malloc(types->capacity * sizeof(Type));
+    if (!types->types) {
+        type_table_destroy(types);
+        return NULL;
+    }
+    types->types[0] = builtins[0];
+    types->count = 1;
+    for (TypeId id = 1; id < TYPE_BUILTIN_END; id++) {
+        if (add_type(types, &builtins[id]) != id) {
+            type_table_destroy(types);
+            return NULL;
+        }
+    }
+    return types;
+}
+
+void type_table_destroy(TypeTable *types) {
+    if (!types) return;
+    free(types->types);
+    free(types->by_name);
+    free(types);
+}
+
+/* class instances are handled through a pointer, so they take one word */
+TypeId type_for_name(TypeTable *types, InternId name) {
+    if (!name) return TYPE_NIL;
+    if (name < types->by_name_capacity && types->by_name[name])
+        return types->by_name[name];
+    Type type = {name, TYPE_KIND_CLASS, WORD_SIZE, WORD_SIZE};
+    TypeId id = add_type(types, &type);
+    return id ? id : TYPE_ERROR;
+}
+
+const Type *type_get(const TypeTable *types, TypeId id) {
+    return id && id < types->count ? &types->types[id] : NULL;
+}
+
+const char *type_name(const TypeTable *types, TypeId id) {
+    const Type *type = type_get(types, id);
+    return type ? intern_str(types->names, type->name) : NULL;
+}
+
+int type_size(const TypeTable *types, TypeId id) {
+    const Type *type = type_get(types, id);
+    return type ? type->size : WORD_SIZE;
+}
+
+int type_is_numeric(TypeId id) {
+    return id == TYPE_INT || id == TYPE_FLOAT;
+}
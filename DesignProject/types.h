@@ -0,0 +1,43 @@
+#ifndef TYPES_H
+#define TYPES_H
+
+#include "intern.h"
+
+/* type descriptors: builtins have the fixed ids below, every other type
+   name (a class) gets the next id the first time it is seen */
+typedef unsigned int TypeId;     /* 0 is reserved for "no type" */
+
+enum {
+    TYPE_ERROR = 1,                /* "<error>": already reported */
+    TYPE_NIL,                      /* "<nil>": no declared type */
+    TYPE_VOID_VALUE,               /* "<void>": no expression */
+    TYPE_VOID,
+    TYPE_INT,
+    TYPE_FLOAT,
+    TYPE_STRING,
+    TYPE_BUILTIN_END
+};
+
+typedef enum { TYPE_KIND_SPECIAL, TYPE_KIND_VOID, TYPE_KIND_INT, TYPE_KIND_FLOAT, TYPE_KIND_STRING, TYPE_KIND_CLASS } TypeKind;
+
+typedef struct Type {
+    InternId name;
+    TypeKind kind;
+    int size;                      /* bytes a variable of this type reserves */
+    int align;
+} Type;
+
+typedef struct TypeTable TypeTable;
+
+/* names is borrowed and must outlive the table */
+TypeTable *type_table_create(InternPool *names);
+void type_table_destroy(TypeTable *types);
+/* the type a declaration names; 0 gives TYPE_NIL, unknown names a class type */
+TypeId type_for_name(TypeTable *types, InternId name);
+/* NULL for an id the table never handed out */
+const Type *type_get(const TypeTable *types, TypeId id);
+const char *type_name(const TypeTable *types, TypeId id);
+int type_size(const TypeTable *types, TypeId id);
+int type_is_numeric(TypeId id);
+
+#endif
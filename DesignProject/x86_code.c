@@ -0,0 +1,181 @@
+#include <stdlib.h>
+#include "x86_code.h"
+
+static const char *const REG_NAMES[X86_REG_COUNT] = {
+    "EAX", "EBX", "ECX", "EDX", "ESI", "EDI", "EBP", "ESP",
+    "XMM0", "XMM1", "XMM2", "XMM3", "XMM4", "XMM5", "XMM6", "XMM7", "AL"
+};
+
+/* indexed by X86Op; setcc/jcc take their suffix from the condition */
+static const char *const MNEMONICS[X86_OP_COUNT] = {
+    NULL, "mov", "movzx",
+    "add", "sub", "and", "or", "xor",
+    "neg", "not",
+    "shl", "sar", "shr",
+    "mul", "imul",
+    "idiv", "cdq", "imul",
+    "cmp", "test", "set",
+    "jmp", "j",
+    "push", "pop",
+    "call", "ret",
+    "fld", "fstp",
+    "movsd", "addsd", "subsd", "mulsd", "divsd",
+    "ucomisd", "cvtsi2sd", "xorpd"
+};
+
+static const char *const COND_SUFFIX[] = { "e", "ne", "l", "g", "le", "ge", "z", "nz", "b", "a", "be", "ae" };
+
+void x86_code_init(X86Code *code) {
+    code->insns = NULL;
+    code->count = 0;
+    code->capacity = 0;
+    code->vregCount = 0;
+}
+
+void x86_code_free(X86Code *code) {
+    free(code->insns);
+    x86_code_init(code);
+}
+
+X86Insn *x86_emit(X86Code *code, X86Op op, X86Operand dst, X86Operand src) {
+    if (code->count == code->capacity) {
+        int capacity = code->capacity ? code->capacity * 2 : 64;
+        X86Insn *grown = (X86Insn*)realloc(code->insns, (size_t)capacity * sizeof(X86Insn));
+        if (!grown) return NULL;
+        code->insns = grown;
+        code->capacity = capacity;
+    }
+    X86Insn *insn = &code->insns[code->count++];
+    insn->op = op;
+    insn->cond = X86_CC_E;
+    insn->dst = dst;
+    insn->src = src;
+    insn->comment = NULL;
+    return insn;
+}
+
+int x86_code_append(X86Code *code, const X86Code *tail) {
+    for (int i = 0; i < tail->count; i++) {
+        const X86Insn *in = &tail->insns[i];
+        X86Insn *copy = x86_emit(code, in->op, in->dst, in->src);
+        if (!copy) return -1;
+        copy->cond = in->cond;
+        copy->comment = in->comment;
+    }
+    return 0;
+}
+
+X86Operand x86_new_vreg(X86Code *code) {
+    return x86_reg(X86_VREG_BASE + code->vregCount++);
+}
+
+X86Operand x86_new_xmm_vreg(X86Code *code) {
+    return x86_xmm(X86_VREG_BASE + code->vregCount++);
+}
+
+X86Operand x86_none(void) {
+    X86Operand opd = {X86_OPD_NONE, 0, 0, 0, NULL};
+    return opd;
+}
+
+X86Operand x86_reg(int reg) {
+    X86Operand opd = {X86_OPD_REG, reg, 0, 4, NULL};
+    return opd;
+}
+
+X86Operand x86_xmm(int reg) {
+    X86Operand opd = {X86_OPD_REG, reg, 0, 8, NULL};
+    return opd;
+}
+
+X86Operand x86_imm(int value) {
+    X86Operand opd = {X86_OPD_IMM, 0, value, 4, NULL};
+    return opd;
+}
+
+X86Operand x86_offset(const char *name) {
+    X86Operand opd = {X86_OPD_IMM, 0, 0, 4, name};
+    return opd;
+}
+
+X86Operand x86_mem(int base, int disp) {
+    X86Operand opd = {X86_OPD_MEM, base, disp, 4, NULL};
+    return opd;
+}
+
+X86Operand x86_mem_qword(int base, int disp) {
+    X86Operand opd = {X86_OPD_MEM, base, disp, 8, NULL};
+    return opd;
+}
+
+X86Operand x86_global(const char *name) {
+    X86Operand opd = {X86_OPD_MEM, 0, 0, 4, name};
+    return opd;
+}
+
+X86Operand x86_global_qword(const char *name) {
+    X86Operand opd = {X86_OPD_MEM, 0, 0, 8, name};
+    return opd;
+}
+
+X86Operand x86_label(const char *name) {
+    X86Operand opd = {X86_OPD_LABEL, 0, 0, 0, name};
+    return opd;
+}
+
+int x86_is_vreg(X86Operand opd) {
+    return opd.kind == X86_OPD_REG && opd.reg >= X86_VREG_BASE;
+}
+
+int x86_is_xmm(X86Operand opd) {
+    return opd.kind == X86_OPD_REG && opd.size == 8;
+}
+
+static void print_operand(X86Operand opd, FILE *out) {
+    switch (opd.kind) {
+        case X86_OPD_REG:
+            if (opd.reg >= X86_VREG_BASE) fprintf(out, "v%d", opd.reg - X86_VREG_BASE);
+            else fprintf(out, "%s", REG_NAMES[opd.reg]);
+            break;
+        case X86_OPD_IMM:
+            if (opd.name) fprintf(out, "OFFSET %s", opd.name);
+            else fprintf(out, "%d", opd.value);
+            break;
+        case X86_OPD_MEM:
+            fprintf(out, "%s PTR [", opd.size == 8 ? "QWORD" : "DWORD");
+            if (opd.name) fprintf(out, "%s", opd.name);
+            else if (opd.value > 0) fprintf(out, "%s+%d", REG_NAMES[opd.reg], opd.value);
+            else if (opd.value < 0) fprintf(out, "%s-%d", REG_NAMES[opd.reg], -opd.value);
+            else fprintf(out, "%s", REG_NAMES[opd.reg]);
+            fprintf(out, "]");
+            break;
+        case X86_OPD_LABEL:
+            fprintf(out, "%s", opd.name);
+            break;
+        default:
+            break;
+    }
+}
+
+void x86_code_print(const X86Code *code, FILE *out) {
+    for (int i = 0; i < code->count; i++) {
+        const X86Insn *insn = &code->insns[i];
+        if (insn->op == X86_LABEL) {
+            fprintf(out, "%s:\n", insn->dst.name);
+            continue;
+        }
+        fprintf(out, "    %s", MNEMONICS[insn->op]);
+        if (insn->op == X86_SETCC || insn->op == X86_JCC)
+            fprintf(out, "%s", COND_SUFFIX[insn->cond]);
+        if (insn->dst.kind != X86_OPD_NONE) {
+            fprintf(out, " ");
+            print_operand(insn->dst, out);
+        }
+        if (insn->src.kind != X86_OPD_NONE) {
+            fprintf(out, ", ");
+            print_operand(insn->src, out);
+        }
+        if (insn->comment) fprintf(out, "    ; %s", insn->comment);
+        fprintf(out, "\n");
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef X86_CODE_H
+#define X86_CODE_H
+
+#include <stdio.h>
+
+/* in-memory x86-32 instruction list for one function. Code generation emits
+   into it with virtual registers; the register allocator then rewrites them
+   to machine registers or stack slots before the list is printed. */
+
+/* machine registers; the first six form the general-purpose pool */
+typedef enum {
+    X86_EAX, X86_EBX, X86_ECX, X86_EDX, X86_ESI, X86_EDI,
+    X86_EBP, X86_ESP,
+    X86_XMM0, X86_XMM1, X86_XMM2, X86_XMM3, X86_XMM4, X86_XMM5, X86_XMM6, X86_XMM7,
+    X86_AL,                        /* low byte of EAX, for setcc */
+    X86_REG_COUNT
+} X86Reg;
+
+#define X86_GPR_COUNT 6            /* EAX..EDI */
+#define X86_VREG_BASE 32           /* virtual register numbers start here */
+
+typedef enum {
+    X86_LABEL,                     /* dst is the label being placed */
+    X86_MOV, X86_MOVZX,
+    X86_ADD, X86_SUB, X86_AND, X86_OR, X86_XOR,
+    X86_NEG, X86_NOT,
+    X86_SHL, X86_SAR, X86_SHR,     /* src is an immediate count */
+    X86_MUL, X86_IMUL_WIDE,        /* implicit EDX:EAX = EAX * dst, unsigned or signed */
+    X86_IDIV, X86_CDQ,             /* implicit EDX:EAX */
+    X86_IMUL,                      /* two-operand form, register destination */
+    X86_CMP, X86_TEST, X86_SETCC,
+    X86_JMP, X86_JCC,
+    X86_PUSH, X86_POP,
+    X86_CALL, X86_RET,
+    X86_FLD, X86_FSTP,             /* x87, only to pass doubles through ST(0) */
+    X86_MOVSD, X86_ADDSD, X86_SUBSD, X86_MULSD, X86_DIVSD,
+    X86_UCOMISD, X86_CVTSI2SD, X86_XORPD,
+    X86_OP_COUNT
+} X86Op;
+
+typedef enum {
+    X86_CC_E, X86_CC_NE, X86_CC_L, X86_CC_G, X86_CC_LE, X86_CC_GE, X86_CC_Z, X86_CC_NZ,
+    X86_CC_B, X86_CC_A, X86_CC_BE, X86_CC_AE    /* unsigned, as ucomisd sets them */
+} X86Cond;
+
+typedef enum {
+    X86_OPD_NONE,
+    X86_OPD_REG,                   /* reg: machine register or virtual register; size 8 for XMM */
+    X86_OPD_IMM,                   /* value, or OFFSET name when name is set */
+    X86_OPD_MEM,                   /* [reg+value], or [name] when name is set */
+    X86_OPD_LABEL                  /* name */
+} X86OperandKind;
+
+typedef struct {
+    X86OperandKind kind;
+    int reg;
+    int value;
+    int size;                      /* 4, or 8 for QWORD memory and XMM registers */
+    const char *name;              /* must outlive the list (interned) */
+} X86Operand;
+
+typedef struct {
+    X86Op op;
+    X86Cond cond;                  /* X86_JCC/X86_SETCC */
+    X86Operand dst, src;
+    const char *comment;           /* printed after the instruction; may be NULL */
+} X86Insn;
+
+typedef struct {
+    X86Insn *insns;
+    int count;
+    int capacity;
+    int vregCount;                 /* virtual registers handed out so far */
+} X86Code;
+
+void x86_code_init(X86Code *code);
+void x86_code_free(X86Code *code);
+/* returns NULL if the list cannot grow */
+X86Insn *x86_emit(X86Code *code, X86Op op, X86Operand dst, X86Operand src);
+/* appends a copy of every instruction in tail; -1 if the list cannot grow */
+int x86_code_append(X86Code *code, const X86Code *tail);
+/* a fresh virtual register operand, general-purpose or XMM */
+X86Operand x86_new_vreg(X86Code *code);
+X86Operand x86_new_xmm_vreg(X86Code *code);
+
+X86Operand x86_none(void);
+X86Operand x86_reg(int reg);
+X86Operand x86_xmm(int reg);
+X86Operand x86_imm(int value);
+X86Operand x86_offset(const char *name);
+X86Operand x86_mem(int base, int disp);
+X86Operand x86_mem_qword(int base, int disp);
+X86Operand x86_global(const char *name);
+X86Operand x86_global_qword(const char *name);
+X86Operand x86_label(const char *name);
+
+int x86_is_vreg(X86Operand opd);
+int x86_is_xmm(X86Operand opd);
+void x86_code_print(const X86Code *code, FILE *out);
+
+#endif